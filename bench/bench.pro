@@ -0,0 +1,8 @@
+# Micro-benchmarks: qmake bench/bench.pro && make && ./animator_bench --help
+TEMPLATE       = app
+TARGET         = animator_bench
+CONFIG        += release console
+include(../animator.pri)
+
+SOURCES       += main.cpp harness.cpp
+HEADERS       += harness.h
@@ -0,0 +1,195 @@
+#include "harness.h"
+#include "alloc_tracker.h"
+
+#include <QJsonArray>
+#include <QRegularExpression>
+#include <QSysInfo>
+#include <QThread>
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <iomanip>
+#include <unordered_map>
+
+namespace {
+double elapsedNs(const BenchmarkRunner::Body &body, int64_t iterations) {
+  const auto start = std::chrono::steady_clock::now();
+  body(iterations);
+  const auto end = std::chrono::steady_clock::now();
+  return std::chrono::duration<double, std::nano>(end - start).count();
+}
+
+double median(std::vector<double> values) {
+  std::sort(values.begin(), values.end());
+  const size_t n = values.size();
+  return n % 2 ? values[n / 2] : (values[n / 2 - 1] + values[n / 2]) / 2;
+}
+} // namespace
+
+QJsonObject BenchmarkRunner::Result::toJson() const {
+  QJsonObject ns;
+  ns["median"] = medianNs;
+  ns["min"] = minNs;
+  ns["max"] = maxNs;
+  ns["mad"] = madNs;
+
+  QJsonObject o;
+  o["name"] = name;
+  o["iterations"] = static_cast<qint64>(iterations);
+  o["samples"] = samples;
+  o["nsPerOp"] = ns;
+  o["allocsPerOp"] = allocsPerOp;
+  o["allocBytesPerOp"] = allocBytesPerOp;
+  return o;
+}
+
+void BenchmarkRunner::add(const QString &name, Setup setup) {
+  entries_.push_back({name, std::move(setup)});
+}
+
+void BenchmarkRunner::list(std::ostream &out) const {
+  const QRegularExpression filter(options_.filter);
+  for (const Entry &entry : entries_)
+    if (options_.filter.isEmpty() || filter.match(entry.name).hasMatch())
+      out << entry.name.toStdString() << '\n';
+  out << std::flush;
+}
+
+std::vector<BenchmarkRunner::Result>
+BenchmarkRunner::run(std::ostream &log) {
+  const QRegularExpression filter(options_.filter);
+  const double minSampleNs = options_.minSampleMs * 1e6;
+  std::vector<Result> results;
+
+  for (const Entry &entry : entries_) {
+    if (!options_.filter.isEmpty() && !filter.match(entry.name).hasMatch())
+      continue;
+    log << std::left << std::setw(48) << entry.name.toStdString()
+        << std::flush;
+    const Body body = entry.setup();
+
+    // Calibrate; the runs double as warm-up.
+    int64_t iterations = 1;
+    double ns = elapsedNs(body, iterations);
+    while (ns < minSampleNs && iterations < (int64_t{1} << 40)) {
+      const double scale = ns > 0 ? minSampleNs / ns : 2.0;
+      iterations = static_cast<int64_t>(
+          std::ceil(iterations * std::clamp(scale * 1.1, 1.5, 10.0)));
+      ns = elapsedNs(body, iterations);
+    }
+
+    std::vector<double> perOp;
+    perOp.reserve(options_.samples);
+    for (int s = 0; s < options_.samples; ++s)
+      perOp.push_back(elapsedNs(body, iterations) / iterations);
+
+    Result result;
+    result.name = entry.name;
+    result.iterations = iterations;
+    result.samples = options_.samples;
+    result.medianNs = median(perOp);
+    result.minNs = *std::min_element(perOp.begin(), perOp.end());
+    result.maxNs = *std::max_element(perOp.begin(), perOp.end());
+    std::vector<double> deviations;
+    deviations.reserve(perOp.size());
+    for (double v : perOp)
+      deviations.push_back(std::abs(v - result.medianNs));
+    result.madNs = median(deviations);
+
+    // Kept out of the timed samples: counting costs a little per allocation.
+    AllocTracker::setEnabled(true);
+    const AllocCounts before = AllocTracker::counts();
+    body(iterations);
+    const AllocCounts allocs = AllocTracker::counts() - before;
+    AllocTracker::setEnabled(false);
+    result.allocsPerOp =
+        static_cast<double>(allocs.totalCount()) / iterations;
+    result.allocBytesPerOp =
+        static_cast<double>(allocs.totalBytes()) / iterations;
+    results.push_back(result);
+
+    log << std::right << std::fixed << std::setprecision(1) << std::setw(14)
+        << result.medianNs << " ns/op  +/- " << std::setw(5)
+        << (result.medianNs > 0 ? 100.0 * result.madNs / result.medianNs : 0)
+        << "%" << std::setprecision(2) << std::setw(10) << result.allocsPerOp
+        << " allocs/op" << std::endl;
+  }
+  return results;
+}
+
+QJsonObject BenchmarkRunner::report(const std::vector<Result> &results) const {
+  QJsonObject build;
+#if defined(__clang__)
+  build["compiler"] = QString("clang ") + __clang_version__;
+#elif defined(__GNUC__)
+  build["compiler"] = QString("gcc ") + __VERSION__;
+#endif
+#ifdef NDEBUG
+  build["assertions"] = false;
+#else
+  build["assertions"] = true;
+#endif
+  build["qt"] = qVersion();
+
+  QJsonObject host;
+  host["cpu"] = QSysInfo::currentCpuArchitecture();
+  host["os"] = QSysInfo::prettyProductName();
+  host["threads"] = QThread::idealThreadCount();
+
+  QJsonArray list;
+  for (const Result &r : results)
+    list.append(r.toJson());
+
+  QJsonObject o;
+  o["schema"] = 1;
+  o["samples"] = options_.samples;
+  o["minSampleMs"] = options_.minSampleMs;
+  o["build"] = build;
+  o["host"] = host;
+  o["results"] = list;
+  return o;
+}
+
+void BenchmarkRunner::compare(const QJsonObject &baseline,
+                              const std::vector<Result> &results,
+                              std::ostream &out) {
+  struct Baseline {
+    double ns = 0;
+    double allocs = -1; // -1 for reports without allocation counts
+  };
+  std::unordered_map<std::string, Baseline> before;
+  for (const auto &v : baseline["results"].toArray()) {
+    const QJsonObject o = v.toObject();
+    before[o["name"].toString().toStdString()] = {
+        o["nsPerOp"].toObject()["median"].toDouble(),
+        o["allocsPerOp"].toDouble(-1)};
+  }
+
+  out << std::left << std::setw(48) << "benchmark" << std::right
+      << std::setw(14) << "baseline ns" << std::setw(14) << "current ns"
+      << std::setw(9) << "ratio" << std::setw(24) << "allocs/op" << '\n';
+  for (const Result &r : results) {
+    const std::string name = r.name.toStdString();
+    out << std::left << std::setw(48) << name << std::right << std::fixed
+        << std::setprecision(1);
+    auto it = before.find(name);
+    if (it == before.end() || it->second.ns <= 0) {
+      out << std::setw(14) << "-" << std::setw(14) << r.medianNs
+          << std::setw(9) << "-" << std::setw(24) << std::setprecision(2)
+          << r.allocsPerOp << '\n';
+      continue;
+    }
+    out << std::setw(14) << it->second.ns << std::setw(14) << r.medianNs
+        << std::setw(8) << std::setprecision(2) << r.medianNs / it->second.ns
+        << "x";
+    // Allocation counts are exact, so any change is worth a look.
+    const double allocsBefore = it->second.allocs;
+    if (allocsBefore >= 0 && std::abs(r.allocsPerOp - allocsBefore) > 0.005)
+      out << std::setw(12) << allocsBefore << " -> " << std::setw(8)
+          << r.allocsPerOp << '\n';
+    else
+      out << std::setw(24) << r.allocsPerOp << '\n';
+  }
+  out << std::flush;
+}
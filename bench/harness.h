@@ -0,0 +1,74 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QString>
+
+#include <cstdint>
+#include <functional>
+#include <ostream>
+#include <vector>
+
+// Keeps the compiler from optimizing away a value that is computed but never
+// used, without costing more than a register spill.
+template <typename T> inline void doNotOptimize(const T &value) {
+  asm volatile("" : : "r,m"(value) : "memory");
+}
+
+// Small benchmark runner whose JSON output can be compared across builds.
+//
+// A benchmark is registered as a setup function that builds its fixture and
+// returns the measured body; the body performs `iterations` operations. The
+// runner first doubles the iteration count until one sample takes at least
+// `minSampleMs`, which also warms caches, then times `samples` samples of
+// that size. Per-operation times are reported as median, min, max and median
+// absolute deviation; the median and MAD shrug off the odd scheduler hiccup,
+// so repeated runs of one build agree to within a few percent. One more
+// sample runs with AllocTracker on to count allocations per operation,
+// which, unlike times, should match exactly between runs of one build.
+class BenchmarkRunner {
+public:
+  using Body = std::function<void(int64_t iterations)>;
+  using Setup = std::function<Body()>;
+
+  struct Options {
+    int samples = 15;
+    double minSampleMs = 20.0;
+    QString filter; // regular expression; empty runs everything
+  };
+
+  struct Result {
+    QString name;
+    int64_t iterations = 0; // per sample
+    int samples = 0;
+    double medianNs = 0, minNs = 0, maxNs = 0, madNs = 0; // per operation
+    double allocsPerOp = 0, allocBytesPerOp = 0; // Lua included
+
+    QJsonObject toJson() const;
+  };
+
+  explicit BenchmarkRunner(Options options) : options_(std::move(options)) {}
+
+  void add(const QString &name, Setup setup);
+  // Prints the names that match the filter, one per line.
+  void list(std::ostream &out) const;
+
+  // Runs the matching benchmarks in registration order, printing progress to
+  // `log`. Setup only runs for benchmarks that match the filter.
+  std::vector<Result> run(std::ostream &log);
+
+  QJsonObject report(const std::vector<Result> &results) const;
+
+  // Prints the median and allocations of every benchmark next to the ones
+  // in `baseline`, a report written by an earlier run.
+  static void compare(const QJsonObject &baseline,
+                      const std::vector<Result> &results, std::ostream &out);
+
+private:
+  struct Entry {
+    QString name;
+    Setup setup;
+  };
+
+  Options options_;
+  std::vector<Entry> entries_;
+};
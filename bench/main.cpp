@@ -0,0 +1,322 @@
+// Micro-benchmarks for the engine's hot paths. Prints one line per benchmark
+// and writes a JSON report that `--baseline` can compare a later run against:
+//
+//   animator_bench --output before.json
+//   ... change and rebuild ...
+//   animator_bench --baseline before.json --output after.json
+//
+// Fixtures are deterministic (fixed rand() seed, fixed scene layouts), so the
+// numbers of two builds measure the code, not the data.
+#include "harness.h"
+
+#include "commands.h"
+#include "exporter.h"
+#include "scene.h"
+#include "serialization.h"
+
+#include "../lib/timeline.h"
+#include "../lib/shapes.h"
+
+#include "include/core/SkSurface.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QFile>
+#include <QJsonDocument>
+#include <QTemporaryDir>
+#include <QThreadPool>
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <iostream>
+#include <iterator>
+#include <memory>
+
+namespace {
+// Every kind ShapeFactory::create knows.
+const char *const kShapeKinds[] = {
+    "Rectangle", "Circle", "RegularPolygram", "Line", "Arc",
+    "ArcBetweenPoints", "CurvedArrow", "CurvedDoubleArrow", "AnnularSector",
+    "Sector", "Annulus", "CubicBezier", "ArcPolygon", "Empty"};
+
+// Kinds the scene benchmarks cycle through, roughly what editor scenes hold.
+const char *const kSceneKinds[] = {"Circle", "Rectangle", "RegularPolygram",
+                                   "Line", "Arc"};
+
+constexpr int kViewWidth = 1280, kViewHeight = 720;
+
+std::unique_ptr<Scene> makeScene(int entityCount) {
+  auto scene = std::make_unique<Scene>(nullptr);
+  // The constructor may rebuild the C++ script header in the background;
+  // never let that compete with a measurement.
+  QThreadPool::globalInstance()->waitForDone();
+
+  std::srand(1);
+  const int columns = static_cast<int>(std::ceil(std::sqrt(
+      entityCount * static_cast<float>(kViewWidth) / kViewHeight)));
+  const float spacing = static_cast<float>(kViewWidth) / columns;
+  for (int i = 0; i < entityCount; ++i)
+    scene->createShape(kSceneKinds[i % std::size(kSceneKinds)],
+                       (i % columns + 0.5f) * spacing,
+                       (i / columns + 0.5f) * spacing);
+  return scene;
+}
+
+sk_sp<SkSurface> makeSurface(int width, int height) {
+  return SkSurfaces::Raster(SkImageInfo::MakeN32Premul(width, height));
+}
+
+void addShapeBenchmarks(BenchmarkRunner &runner) {
+  for (const char *kind : kShapeKinds)
+    runner.add(QString("shape/rebuildPaths/%1").arg(kind), [kind] {
+      std::shared_ptr<Shape> shape = ShapeFactory::create(kind);
+      return [shape](int64_t n) {
+        for (int64_t i = 0; i < n; ++i)
+          shape->rebuildPaths();
+      };
+    });
+
+  for (const char *kind : kShapeKinds)
+    runner.add(QString("shape/render/%1").arg(kind), [kind] {
+      struct Fixture {
+        std::unique_ptr<Shape> shape = nullptr;
+        PaintCacheComponent paints;
+        sk_sp<SkSurface> surface = makeSurface(512, 512);
+      };
+      auto f = std::make_shared<Fixture>();
+      f->shape = ShapeFactory::create(kind);
+      f->paints.rebuild(MaterialComponent{}, nullptr);
+      f->surface->getCanvas()->translate(256, 256);
+      return [f](int64_t n) {
+        SkCanvas *canvas = f->surface->getCanvas();
+        for (int64_t i = 0; i < n; ++i)
+          f->shape->render(canvas, f->paints);
+      };
+    });
+}
+
+void addRenderBenchmarks(BenchmarkRunner &runner) {
+  for (int count : {100, 1000, 10000}) {
+    // Steady state: everything is static and replayed from recorded pictures.
+    runner.add(QString("render/static/%1").arg(count), [count] {
+      std::shared_ptr<Scene> scene = makeScene(count);
+      auto surface = makeSurface(kViewWidth, kViewHeight);
+      return [scene, surface](int64_t n) {
+        SkCanvas *canvas = surface->getCanvas();
+        for (int64_t i = 0; i < n; ++i)
+          scene->getRenderer().render(canvas, 0.f);
+      };
+    });
+
+    // Every entity moves each frame: observers, spatial index and live draws.
+    runner.add(QString("render/moving/%1").arg(count), [count] {
+      std::shared_ptr<Scene> scene = makeScene(count);
+      auto surface = makeSurface(kViewWidth, kViewHeight);
+      auto frame = std::make_shared<int64_t>(0);
+      return [scene, surface, frame](int64_t n) {
+        SkCanvas *canvas = surface->getCanvas();
+        for (int64_t i = 0; i < n; ++i) {
+          const float dx = (++*frame & 1) ? 0.5f : -0.5f;
+          scene->ecs().each(
+              [dx](flecs::entity e, TransformComponent &tr) {
+                tr.x += dx;
+                e.modified<TransformComponent>();
+              });
+          scene->getRenderer().render(canvas, 0.f);
+        }
+      };
+    });
+  }
+}
+
+void addSceneBenchmarks(BenchmarkRunner &runner) {
+  runner.add("scene/serialize/1000", [] {
+    std::shared_ptr<Scene> scene = makeScene(1000);
+    return [scene](int64_t n) {
+      for (int64_t i = 0; i < n; ++i)
+        doNotOptimize(scene->serialize());
+    };
+  });
+
+  runner.add("scene/deserialize/1000", [] {
+    std::shared_ptr<Scene> scene = makeScene(1000);
+    const QJsonObject json = scene->serialize();
+    return [scene, json](int64_t n) {
+      for (int64_t i = 0; i < n; ++i)
+        scene->deserialize(json);
+    };
+  });
+
+  // Paste into a scene of 1000 entities; name uniqueness scans them all.
+  runner.add("scene/applyJsonToEntity/1000", [] {
+    std::shared_ptr<Scene> scene = makeScene(1000);
+    flecs::entity source = scene->createShape("Circle", 10.f, 10.f);
+    const QJsonObject json = serializeEntity(*scene, source);
+    return [scene, json](int64_t n) {
+      flecs::world &world = scene->ecs();
+      for (int64_t i = 0; i < n; ++i) {
+        flecs::entity e = world.entity();
+        applyJsonToEntity(world, e, json, true);
+        e.destruct();
+      }
+    };
+  });
+}
+
+void addLuaBenchmarks(BenchmarkRunner &runner) {
+  struct Script {
+    const char *name;
+    const char *source;
+  };
+  static const Script kScripts[] = {
+      {"empty", "function on_update(entity, registry, dt, t) end\n"},
+      {"get_transform",
+       "function on_update(entity, registry, dt, t)\n"
+       "  local tr = registry:get_transform(entity)\n"
+       "  tr.x = tr.x + dt\n"
+       "end\n"},
+  };
+
+  for (const Script &script : kScripts)
+    runner.add(QString("lua/call/%1").arg(script.name), [script] {
+      struct Fixture {
+        QTemporaryDir dir;
+        std::unique_ptr<Scene> scene = makeScene(1);
+        sol::table env;
+      };
+      auto f = std::make_shared<Fixture>();
+      const QString path = f->dir.filePath("bench.lua");
+      QFile file(path);
+      if (file.open(QIODevice::WriteOnly))
+        file.write(script.source);
+      file.close();
+
+      flecs::entity e = f->scene->createShape("Circle", 0.f, 0.f);
+      f->env = f->scene->getScriptSystem().getEngine().loadScript(
+          path.toStdString(), e);
+      if (!f->env.valid())
+        std::cerr << "could not load " << path.toStdString() << std::endl;
+      return [f](int64_t n) {
+        ScriptingEngine &engine = f->scene->getScriptSystem().getEngine();
+        for (int64_t i = 0; i < n; ++i)
+          engine.call(f->env, "on_update", 1.f / 60.f, 0.f);
+      };
+    });
+}
+
+std::shared_ptr<std::vector<AnimationTrack>> makeTracks(int count) {
+  auto tracks = std::make_shared<std::vector<AnimationTrack>>();
+  for (int i = 0; i < count; ++i) {
+    const SkPoint at = {static_cast<float>(i % 10) * 100.f,
+                        static_cast<float>(i / 10) * 100.f};
+    switch (i % 4) {
+    case 0:
+      tracks->push_back({create_circle(at, 40), fade_in(), linear, 0, 2});
+      break;
+    case 1:
+      tracks->push_back(
+          {create_square(at, 60), rotate(360), ease_out_expo, 0, 2});
+      break;
+    case 2:
+      tracks->push_back({create_regular_polygon(at, 5, 40), scale(2.f),
+                         ease_in_back, 0, 2});
+      break;
+    default:
+      tracks->push_back({create_circle(at, 20), move_to({0, 0}),
+                         ease_in_out_quad, 0, 2});
+      break;
+    }
+  }
+  return tracks;
+}
+
+void addTimelineBenchmarks(BenchmarkRunner &runner) {
+  for (int count : {10, 100}) {
+    runner.add(QString("lib/get_mobjects_at_time/%1").arg(count), [count] {
+      auto tracks = makeTracks(count);
+      return [tracks](int64_t n) {
+        for (int64_t i = 0; i < n; ++i)
+          doNotOptimize(get_mobjects_at_time(*tracks, 1.f).size());
+      };
+    });
+    // The list in a frame arena, reset after every call like a frame would.
+    runner.add(
+        QString("lib/get_mobjects_at_time/arena/%1").arg(count), [count] {
+          auto tracks = makeTracks(count);
+          auto arena = std::make_shared<FrameArena>();
+          return [tracks, arena](int64_t n) {
+            for (int64_t i = 0; i < n; ++i) {
+              doNotOptimize(
+                  get_mobjects_at_time(*tracks, 1.f, arena.get()).size());
+              arena->reset();
+            }
+          };
+        });
+  }
+}
+} // namespace
+
+int main(int argc, char **argv) {
+  QCoreApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription("Micro-benchmarks for the animator engine.");
+  parser.addHelpOption();
+  QCommandLineOption filterOpt(
+      "filter", "Only run benchmarks whose name matches this regex.", "regex");
+  QCommandLineOption samplesOpt("samples", "Timed samples per benchmark.",
+                                "n", "15");
+  QCommandLineOption minSampleOpt(
+      "min-sample-ms", "Minimum duration of one sample.", "ms", "20");
+  QCommandLineOption outputOpt({"o", "output"},
+                               "Write the JSON report here.", "file");
+  QCommandLineOption baselineOpt(
+      "baseline", "Compare against a report from an earlier run.", "file");
+  QCommandLineOption listOpt("list", "List benchmark names and exit.");
+  parser.addOptions(
+      {filterOpt, samplesOpt, minSampleOpt, outputOpt, baselineOpt, listOpt});
+  parser.process(app);
+
+  BenchmarkRunner::Options options;
+  options.filter = parser.value(filterOpt);
+  options.samples = std::max(1, parser.value(samplesOpt).toInt());
+  options.minSampleMs = std::max(1.0, parser.value(minSampleOpt).toDouble());
+
+  BenchmarkRunner runner(options);
+  addShapeBenchmarks(runner);
+  addRenderBenchmarks(runner);
+  addSceneBenchmarks(runner);
+  addLuaBenchmarks(runner);
+  addTimelineBenchmarks(runner);
+
+  if (parser.isSet(listOpt)) {
+    runner.list(std::cout);
+    return 0;
+  }
+
+  const std::vector<BenchmarkRunner::Result> results = runner.run(std::cout);
+  const QByteArray json = QJsonDocument(runner.report(results)).toJson();
+
+  if (parser.isSet(outputOpt)) {
+    QFile out(parser.value(outputOpt));
+    if (!out.open(QIODevice::WriteOnly) || out.write(json) < 0) {
+      std::cerr << "animator_bench: could not write "
+                << parser.value(outputOpt).toStdString() << std::endl;
+      return 1;
+    }
+  }
+
+  if (parser.isSet(baselineOpt)) {
+    QFile in(parser.value(baselineOpt));
+    if (!in.open(QIODevice::ReadOnly)) {
+      std::cerr << "animator_bench: could not read "
+                << parser.value(baselineOpt).toStdString() << std::endl;
+      return 1;
+    }
+    std::cout << '\n';
+    BenchmarkRunner::compare(QJsonDocument::fromJson(in.readAll()).object(),
+                             results, std::cout);
+  }
+  return 0;
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Allocations made by one thread, split by allocator.
+struct AllocCounts {
+  uint64_t count = 0, bytes = 0;       // global operator new
+  uint64_t luaCount = 0, luaBytes = 0; // the Lua state's allocator
+
+  uint64_t totalCount() const { return count + luaCount; }
+  uint64_t totalBytes() const { return bytes + luaBytes; }
+
+  AllocCounts operator-(const AllocCounts &o) const {
+    return {count - o.count, bytes - o.bytes, luaCount - o.luaCount,
+            luaBytes - o.luaBytes};
+  }
+  AllocCounts &operator+=(const AllocCounts &o) {
+    count += o.count;
+    bytes += o.bytes;
+    luaCount += o.luaCount;
+    luaBytes += o.luaBytes;
+    return *this;
+  }
+};
+
+// Counts heap allocations per thread, through replacements of the global
+// operator new and a wrapper around the Lua allocator. Tracking is off by
+// default; an allocation then pays one relaxed atomic load. Only
+// allocations are counted, not frees: the question this answers is which
+// code allocates in a frame that should not, not how much memory is live.
+//
+// Consumers take counts() before and after a piece of work on the same
+// thread and look at the difference.
+class AllocTracker {
+public:
+  static void setEnabled(bool enabled) {
+    enabled_.store(enabled, std::memory_order_relaxed);
+  }
+  static bool enabled() { return enabled_.load(std::memory_order_relaxed); }
+
+  // Running totals of the calling thread while tracking was on.
+  static AllocCounts counts();
+
+  static void noteNew(size_t bytes);
+  static void noteLua(size_t bytes);
+
+private:
+  static std::atomic<bool> enabled_;
+};
@@ -1,4 +1,7 @@
 #pragma once
+#include "flight_recorder.h"
+#include "frame_cache.h"
+#include "memory_report.h"
 #include "scene.h"
 #include "shapes.h"
 
@@ -24,11 +27,15 @@
 #include <QOpenGLExtraFunctions>
 #include <QOpenGLFunctions>
 #include <QOpenGLWidget>
+#include <QSet>
 #include <QSurfaceFormat>
+#include <QTimer>
 #include <QWheelEvent>
 
+#include <algorithm>
 #include <cmath>
 #include <memory>
+#include <vector>
 
 using namespace skgpu::ganesh;
 
@@ -36,15 +43,50 @@ class SkiaCanvasWidget : public QOpenGLWidget, protected QOpenGLFunctions {
   Q_OBJECT
 public:
   explicit SkiaCanvasWidget(QWidget *parent = nullptr)
-      : QOpenGLWidget(parent), scene_(std::make_unique<Scene>(this)) {
+      : QOpenGLWidget(parent), scene_(std::make_unique<Scene>(this)),
+        m_flightRecorder(scene_->profiler().samples()) {
     setAcceptDrops(true);
+    // Keep the previous frame in the FBO so paintGL can redraw only the
+    // damaged area.
+    setUpdateBehavior(QOpenGLWidget::PartialUpdate);
     m_viewMatrix.setIdentity();
+    trackDamage();
+    // Restarted by every paint, so it only fires once the view is idle.
+    m_prefetchTimer.setSingleShot(true);
+    connect(&m_prefetchTimer, &QTimer::timeout, this,
+            &SkiaCanvasWidget::prefetchFrames);
+    m_proxyIdleTimer.setSingleShot(true);
+    connect(&m_proxyIdleTimer, &QTimer::timeout, this, [this] {
+      setProxyLevel(0);
+      update();
+    });
+  }
+  ~SkiaCanvasWidget() override {
+    // Tear the scene down first: its observers report damage to this widget.
+    scene_.reset();
   }
 
   Scene &scene() { return *scene_; }
   const QList<Entity> &getSelectedEntities() const { return selectedEntities_; }
   void setSceneResetting(bool resetting) { m_isSceneBeingReset = resetting; }
   void setCurrentTime(float t) { currentTime_ = t; }
+  // Prefetching stays within [0, seconds].
+  void setTimelineDuration(float seconds) { m_timelineDuration = seconds; }
+  // Playback paints every frame itself; prefetching waits until it stops.
+  void setPlaying(bool playing);
+  FrameCache &frameCache() { return m_frameCache; }
+
+  // Interactive frames slower than this drop to a lower preview quality.
+  void setFrameBudget(double ms) { m_frameBudgetMs = ms; }
+
+  // Frame timing graph drawn over the scene; needs the scene's profiler
+  // enabled to show anything.
+  void setProfilerOverlayVisible(bool visible);
+  bool profilerOverlayVisible() const { return m_showProfilerOverlay; }
+  // Dumps recent frame timings when a frame runs over its budget.
+  FlightRecorder &flightRecorder() { return m_flightRecorder; }
+  // Adds the frame cache and the GPU resource cache to `section`.
+  void measureMemory(MemoryReport::Section &section);
 
   void setSelectedEntity(Entity entity);
   void setSelectedEntities(const QList<Entity> &entities);
@@ -52,7 +94,12 @@ public:
 
   void setVideoRendering(bool isRendering);
 
-  QImage renderHighResFrame(int width, int height, float time);
+  // Renders one frame offscreen. With threads != 1 the frame is recorded once
+  // and rasterized in tiles on that many threads (0 = one per core).
+  QImage renderHighResFrame(int width, int height, float time,
+                            int threads = 1);
+  // Scene-to-output transform used by renderHighResFrame and video export.
+  SkMatrix exportMatrix(int width, int height) const;
 
   // View controls
   void resetView();
@@ -110,6 +157,8 @@ protected:
 
   void drawMarquee(SkCanvas *c);
 
+  void drawProfilerOverlay(SkCanvas *c);
+
 signals:
   void sceneChanged();
   void transformChanged(Entity entity);
@@ -120,9 +169,43 @@ signals:
   void entityAdded(Entity entity);
   void dragStarted();
   void dragEnded();
+  // Preview quality changed; level 0 is full quality.
+  void proxyLevelChanged(int level, float scale, bool draft);
 
 private:
   SkPoint mapScreenToView(const QPointF &point) const;
+
+  // Partial repaint: collect damaged areas between frames and turn them into
+  // the device-space rect paintGL clips to.
+  void trackDamage();
+  void invalidateAll() { m_fullRepaint = true; }
+  SkIRect takeDamage();
+  SkIRect overlayBounds() const;
+
+  void drawScene(SkCanvas *canvas, bool timeChanged, bool draft);
+
+  // While interaction is too slow, the scene is drawn into a smaller
+  // offscreen surface and upscaled; full quality returns when idle.
+  sk_sp<SkSurface> proxySurface();
+  void adaptProxyLevel(double frameMs);
+  void setProxyLevel(int level);
+
+  // Scrubbing: whole frames are recorded once per scene revision and timeline
+  // step, then replayed. Idle time records the frames around the playhead.
+  bool frameCacheUsable();
+  sk_sp<SkPicture> cachedFrame(bool recordOnMiss);
+  sk_sp<SkPicture> recordFrame(int64_t tick);
+  void prefetchFrames();
+  void schedulePrefetch();
+
+  // Selection store: the list keeps order for signals, the set answers
+  // membership in O(1). Always modify both through these helpers.
+  bool isSelected(Entity entity) const {
+    return selectedIds_.contains(entity.id());
+  }
+  void select(Entity entity);
+  void deselect(Entity entity);
+  void clearSelection();
   struct TransformData {
     float x, y, rotation, sx, sy;
   };
@@ -132,12 +215,15 @@ private:
   sk_sp<SkSurface> fSurface;
   sk_sp<const GrGLInterface> iface;
   sk_sp<SkFontMgr> fontMgr;
+  SkFont m_hudFont;
 
   // Scene wrapper
   std::unique_ptr<Scene> scene_;
 
   // Interaction state
   QList<Entity> selectedEntities_;
+  QSet<flecs::entity_t> selectedIds_;
+  std::vector<flecs::entity_t> spatialHits_; // reused query buffer
   bool isDragging_ = false, isRotating_ = false, isMarqueeSelecting_ = false;
   bool m_isSceneBeingReset = false;
   bool m_isRenderingVideo = false;
@@ -145,6 +231,32 @@ private:
   float currentTime_ = 0.f;
   QMap<Entity, TransformData> initialTransforms_;
 
+  // Damage state. World-space damage comes from the spatial index; changes
+  // that affect the whole picture (view, time, scripts) set m_fullRepaint.
+  SkRect m_worldDamage = SkRect::MakeEmpty();
+  SkIRect m_lastOverlayBounds = SkIRect::MakeEmpty();
+  SkMatrix m_lastViewMatrix;
+  float m_lastPaintTime = 0.f;
+  bool m_fullRepaint = true;
+
+  // Frame cache state
+  FrameCache m_frameCache;
+  QTimer m_prefetchTimer;
+  bool m_isPlaying = false;
+  float m_timelineDuration = 5.f;
+  int64_t m_prefetchCenter = -1; // playhead tick of the current prefetch pass
+  int m_prefetchRecorded = 0;    // frames recorded in that pass
+  qint64 m_prefetchFrameMs = 0;  // how long the last prefetched frame took
+
+  // Proxy resolution state
+  sk_sp<SkSurface> m_proxySurface;
+  QTimer m_proxyIdleTimer;
+  int m_proxyLevel = 0;
+  double m_frameBudgetMs = 1000.0 / 60.0;
+
+  bool m_showProfilerOverlay = false;
+  FlightRecorder m_flightRecorder;
+
   // View state
   SkMatrix m_viewMatrix;
   bool m_isPanning = false;
@@ -13,11 +13,17 @@ class Scene;
 void applyJsonToEntity(flecs::world &world, flecs::entity e,
                        const QJsonObject &o, bool is_paste);
 
+// Rough heap size of a JSON snapshot (its compact encoding), for memory
+// reports. Implicitly shared copies are counted every time.
+size_t jsonBytes(const QJsonObject &o);
+
 class SceneCommand : public QUndoCommand {
 public:
   using QUndoCommand::QUndoCommand;
   template <typename T> static const char *getComponentJsonKey();
   virtual void updateEntityIds(const QMap<qint64, Entity> &) {}
+  // Memory held by the command, snapshots included.
+  virtual size_t approximateBytes() const { return sizeof(SceneCommand); }
 };
 
 template <typename T> class SetComponentCommand : public SceneCommand {
@@ -63,6 +69,10 @@ public:
     }
   }
 
+  size_t approximateBytes() const override {
+    return sizeof(*this) + jsonBytes(m_oldData) + jsonBytes(m_newData);
+  }
+
 private:
   MainWindow *m_mainWindow;
   Entity m_entity;
@@ -76,6 +86,9 @@ public:
   void undo() override;
   void redo() override;
   void updateEntityIds(const QMap<qint64, Entity> &idMap) override;
+  size_t approximateBytes() const override {
+    return sizeof(*this) + jsonBytes(m_entityData);
+  }
 
 private:
   MainWindow *m_mainWindow;
@@ -91,6 +104,9 @@ public:
   void undo() override;
   void redo() override;
   void updateEntityIds(const QMap<qint64, Entity> &idMap) override;
+  size_t approximateBytes() const override {
+    return sizeof(*this) + jsonBytes(m_entityData);
+  }
 
 private:
   MainWindow *m_mainWindow;
@@ -105,6 +121,12 @@ public:
   void undo() override;
   void redo() override;
   void updateEntityIds(const QMap<qint64, Entity> &idMap) override;
+  size_t approximateBytes() const override {
+    size_t bytes = sizeof(*this);
+    for (const QJsonObject &data : m_entitiesData)
+      bytes += jsonBytes(data);
+    return bytes;
+  }
 
 private:
   MainWindow *m_mainWindow;
@@ -119,6 +141,12 @@ public:
   void undo() override;
   void redo() override;
   void updateEntityIds(const QMap<qint64, Entity> &idMap) override;
+  size_t approximateBytes() const override {
+    size_t bytes = sizeof(*this);
+    for (const QJsonObject &data : m_entitiesData)
+      bytes += jsonBytes(data);
+    return bytes;
+  }
 
 private:
   MainWindow *m_mainWindow;
@@ -245,6 +273,9 @@ public:
   void undo() override;
   void redo() override;
   void updateEntityIds(const QMap<qint64, Entity> &idMap) override;
+  size_t approximateBytes() const override {
+    return sizeof(*this) + jsonBytes(m_oldProps) + jsonBytes(m_newProps);
+  }
 
 private:
   MainWindow *m_mainWindow;
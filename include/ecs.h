@@ -10,6 +10,7 @@
 #include "include/core/SkFont.h"
 #include "include/core/SkFontMgr.h"
 #include "include/core/SkImage.h"
+#include "include/core/SkMatrix.h"
 #include "include/core/SkPaint.h"
 #include "include/core/SkPath.h"
 #include "include/core/SkPathEffect.h"
@@ -22,6 +23,8 @@
 #include <QMetaProperty>
 
 #include <sol/sol.hpp>
+#include <algorithm>
+#include <cmath>
 #include <string>
 #include <type_traits>
 #include <vector>
@@ -121,10 +124,42 @@ struct TransformComponent {
   float x = 0.f, y = 0.f;
   float rotation = 0.f;     // radians
   float sx = 1.f, sy = 1.f; // scale
+
+  // Local-to-world matrix, matching the canvas transform used for drawing.
+  SkMatrix matrix() const {
+    SkMatrix m;
+    m.setTranslate(x, y);
+    m.preRotate(rotation * 180 / M_PI);
+    m.preScale(sx, sy);
+    return m;
+  }
 };
 
 #include "shapes.h"
 
+// Bumped by RenderSystem observers whenever something that affects how the
+// entity is drawn is set. Recorded pictures are keyed by these versions.
+struct RenderVersionComponent {
+  uint32_t version = 0;
+  uint32_t stableFrames = 0; // renders since the last bump, saturating
+  uint32_t drawOrder = 0;    // position in the last frame's draw list
+};
+
+// World-space AABB of what the entity draws, maintained by SpatialIndex.
+struct WorldBoundsComponent {
+  SkRect bounds = SkRect::MakeEmpty();
+};
+
+// How far drawing may reach past the path bounds in local units: miter joins
+// at SkPaint's default limit and discrete jitter.
+inline float drawBoundsOutset(const MaterialComponent *material,
+                              const PathEffectComponent *effect) {
+  float outset = material ? material->strokeWidth * 2.f : 0.f;
+  if (effect && effect->type == PathEffectComponent::Type::Discrete)
+    outset += std::abs(effect->discreteDeviation);
+  return outset;
+}
+
 struct ShapeComponent {
   std::unique_ptr<Shape> shape;
   ShapeComponent() = default;
@@ -132,3 +167,131 @@ struct ShapeComponent {
   ShapeComponent(ShapeComponent &&) noexcept = default;
   ShapeComponent &operator=(ShapeComponent &&) noexcept = default;
 };
+
+// Many copies of one shape drawn by a single entity, e.g. particles. The
+// per-instance data lives in parallel arrays in the entity's local space:
+// instance i is the shape rotated by rotation[i] radians, scaled uniformly by
+// scale[i] and moved to (x[i], y[i]). `color` is either empty, in which case
+// every instance uses the material color, or holds one color per instance.
+//
+// Instances are runtime state written by scripts and are not serialized.
+// Call modified<InstancedShapeComponent>() after writing so bounds and cached
+// pictures are refreshed.
+struct InstancedShapeComponent {
+  std::unique_ptr<Shape> shape;
+  std::vector<float> x, y, rotation, scale;
+  std::vector<SkColor> color;
+
+  InstancedShapeComponent() = default;
+  InstancedShapeComponent(std::unique_ptr<Shape> s) : shape(std::move(s)) {}
+  InstancedShapeComponent(InstancedShapeComponent &&) noexcept = default;
+  InstancedShapeComponent &
+  operator=(InstancedShapeComponent &&) noexcept = default;
+
+  size_t size() const { return x.size(); }
+
+  // New instances sit at the origin, unrotated and at scale 1.
+  void resize(size_t n) {
+    x.resize(n, 0.f);
+    y.resize(n, 0.f);
+    rotation.resize(n, 0.f);
+    scale.resize(n, 1.f);
+    if (!color.empty())
+      color.resize(n, color.back());
+  }
+
+  void set(size_t i, float px, float py, float angle = 0.f, float s = 1.f) {
+    x[i] = px;
+    y[i] = py;
+    rotation[i] = angle;
+    scale[i] = s;
+  }
+
+  // The first call switches from the material color to per-instance colors
+  // and gives every other instance `others`.
+  void setColor(size_t i, SkColor c, SkColor others = SK_ColorBLACK) {
+    if (color.size() != size())
+      color.assign(size(), others);
+    color[i] = c;
+  }
+
+  // Local-space bounds of all instances; `outset` pads the shape bounds,
+  // e.g. for strokes.
+  SkRect bounds(float outset = 0.f) const {
+    if (!shape || x.empty())
+      return SkRect::MakeEmpty();
+    // The farthest the shape reaches from its origin under any rotation.
+    const SkRect box = shape->getBoundingBox().makeOutset(outset, outset);
+    const float reach = std::sqrt(
+        std::max(box.left() * box.left(), box.right() * box.right()) +
+        std::max(box.top() * box.top(), box.bottom() * box.bottom()));
+    SkRect result = SkRect::MakeEmpty();
+    for (size_t i = 0; i < x.size(); ++i) {
+      const float r = reach * std::abs(scale[i]);
+      result.join(SkRect::MakeLTRB(x[i] - r, y[i] - r, x[i] + r, y[i] + r));
+    }
+    return result;
+  }
+};
+
+// Ready-to-draw paints derived from MaterialComponent and PathEffectComponent.
+// Observers in RenderSystem flag the cache dirty whenever either source
+// component is set, so steady-state frames reuse the same Skia objects.
+//
+// The paints never carry the path effect: Shape applies it once to its
+// geometry and keeps the result until filterGeneration changes.
+struct PaintCacheComponent {
+  SkPaint paints[3]; // indexed by PathStyle
+  PathStyle materialStyle = PathStyle::kFill;
+  sk_sp<SkPathEffect> pathEffect;
+  uint32_t filterGeneration = 0;
+  bool dirty = true;
+  bool effectDirty = true;
+
+  void rebuild(const MaterialComponent &material,
+               const PathEffectComponent *effect) {
+    const float oldStrokeWidth =
+        paints[static_cast<int>(PathStyle::kStroke)].getStrokeWidth();
+    const PathStyle oldStyle = materialStyle;
+
+    SkPaint base;
+    base.setAntiAlias(material.antiAliased);
+    base.setColor(material.color);
+    base.setStrokeWidth(material.strokeWidth);
+
+    paints[static_cast<int>(PathStyle::kFill)] = base;
+    paints[static_cast<int>(PathStyle::kFill)].setStyle(SkPaint::kFill_Style);
+    paints[static_cast<int>(PathStyle::kStroke)] = base;
+    paints[static_cast<int>(PathStyle::kStroke)].setStyle(
+        SkPaint::kStroke_Style);
+    paints[static_cast<int>(PathStyle::kStrokeAndFill)] = base;
+    paints[static_cast<int>(PathStyle::kStrokeAndFill)].setStyle(
+        SkPaint::kStrokeAndFill_Style);
+
+    // A material that is neither filled nor stroked keeps SkPaint's default
+    // fill style.
+    if (material.isFilled && material.isStroked)
+      materialStyle = PathStyle::kStrokeAndFill;
+    else if (material.isStroked && !material.isFilled)
+      materialStyle = PathStyle::kStroke;
+    else
+      materialStyle = PathStyle::kFill;
+
+    // Filtered geometry depends on the effect and on the stroke parameters,
+    // not on color or anti-aliasing.
+    if (effectDirty || oldStrokeWidth != material.strokeWidth ||
+        oldStyle != materialStyle) {
+      if (effectDirty)
+        pathEffect = effect ? effect->makePathEffect() : nullptr;
+      filterGeneration = ++s_filterGenerationCounter;
+    }
+    dirty = effectDirty = false;
+  }
+
+  const SkPaint &paintFor(std::optional<PathStyle> style) const {
+    return paints[static_cast<int>(style.value_or(materialStyle))];
+  }
+
+private:
+  inline static uint32_t s_filterGenerationCounter = 0;
+};
@@ -0,0 +1,174 @@
+#pragma once
+#include "scene.h"
+
+#include "include/core/SkColor.h"
+#include "include/core/SkImageInfo.h"
+#include "include/core/SkMatrix.h"
+#include "include/core/SkPicture.h"
+#include "include/core/SkPixmap.h"
+
+#include <QJsonObject>
+#include <QProcess>
+#include <QString>
+#include <QThreadPool>
+
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Destination for exported frames. Every method runs on the exporter's writer
+// thread; frames arrive one at a time and in order.
+class FrameSink {
+public:
+  virtual ~FrameSink() = default;
+
+  virtual bool open(const SkImageInfo &info, int fps) = 0;
+  // `pixels` points into the exporter's ring and is only valid for the call.
+  virtual bool write(int frame, const SkPixmap &pixels) = 0;
+  // Flush and wait until the output is complete.
+  virtual bool close() = 0;
+
+  const QString &errorString() const { return error_; }
+
+protected:
+  QString error_;
+};
+
+// Streams raw RGBA frames through a pipe into ffmpeg, encoding H.264 MP4.
+class FfmpegSink : public FrameSink {
+public:
+  explicit FfmpegSink(const QString &videoPath,
+                      const QString &ffmpegPath = "ffmpeg");
+  ~FfmpegSink() override;
+
+  bool open(const SkImageInfo &info, int fps) override;
+  bool write(int frame, const SkPixmap &pixels) override;
+  bool close() override;
+
+private:
+  QString videoPath_;
+  QString ffmpegPath_;
+  // Created on the writer thread, which is the only thread that touches it.
+  std::unique_ptr<QProcess> process_;
+};
+
+// Writes every frame to `directory` as <prefix><frame number>.<extension>.
+// Encoding is far slower than rasterizing, so write() only copies the frame
+// and queues it on a pool of encoder threads. At most `maxInFlight` copies
+// exist at once; write() blocks while all of them are taken, which caps the
+// memory at maxInFlight * width * height * 4 bytes.
+class ImageSequenceSink : public FrameSink {
+public:
+  enum class Format {
+    Png,
+    WebP, // lossless
+    Raw,  // premultiplied RGBA8888 rows, no header
+  };
+
+  // `encoderThreads` 0 picks QThread::idealThreadCount(); `maxInFlight` 0
+  // uses encoderThreads + 2.
+  explicit ImageSequenceSink(const QString &directory,
+                             Format format = Format::Png,
+                             int encoderThreads = 0, int maxInFlight = 0);
+  ~ImageSequenceSink() override;
+
+  bool open(const SkImageInfo &info, int fps) override;
+  bool write(int frame, const SkPixmap &pixels) override;
+  // Waits for queued frames to finish encoding.
+  bool close() override;
+
+  QString framePath(int frame) const;
+  static QString extension(Format format);
+  // Accepts "png", "webp" and "raw"; returns false for anything else.
+  static bool parseFormat(const QString &name, Format &format);
+
+private:
+  QString directory_;
+  QString prefix_ = "frame_";
+  Format format_;
+  int encoderThreads_;
+  int maxInFlight_;
+
+  std::mutex mutex_;
+  std::condition_variable bufferFreed_;
+  std::vector<std::unique_ptr<uint8_t[]>> freeBuffers_;
+  int buffersAllocated_ = 0;
+  QString encodeError_; // first failure reported by an encoder thread
+
+  // Declared last so it is destroyed, and its jobs finished, first.
+  QThreadPool pool_;
+};
+
+// Offline frame export. Scripts are ticked and each frame is recorded into an
+// SkPicture on the calling thread, since the scene, flecs and Lua are not
+// thread-safe. The recordings are self-contained, so a worker pool rasterizes
+// them straight into a fixed ring of pixel buffers while a writer thread
+// streams finished buffers to the sink in frame order.
+class FrameExporter {
+public:
+  struct Settings {
+    int width = 0, height = 0;
+    int fps = 60;
+    int frameCount = 0;
+    float startTime = 0.f; // timeline seconds of the first frame
+    // Rasterization threads; 0 picks QThread::idealThreadCount().
+    int threads = 0;
+    // Pixel buffers shared by rendering and writing; 0 uses threads + 2.
+    // Bounds memory to ringSize * width * height * 4 bytes.
+    int ringSize = 0;
+    // Scene-to-output transform, see fitTransform().
+    SkMatrix transform = SkMatrix::I();
+    SkColor clearColor = SK_ColorWHITE;
+  };
+
+  struct Result {
+    int framesWritten = 0;
+    int threads = 0;
+    int ringSize = 0;
+    bool cancelled = false;
+    QString error;
+    double wallSeconds = 0;
+    double recordSeconds = 0; // script ticks and recording, calling thread
+    double rasterSeconds = 0; // summed over all workers
+    double writeSeconds = 0;  // writer thread inside FrameSink::write
+
+    double fps() const {
+      return wallSeconds > 0 ? framesWritten / wallSeconds : 0;
+    }
+    // Raster work done per second of wall time. Approaches `threads` while
+    // the pool is saturated; much lower means recording or the sink is the
+    // bottleneck.
+    double parallelism() const {
+      return wallSeconds > 0 ? rasterSeconds / wallSeconds : 0;
+    }
+    QString summary() const;
+    QJsonObject toJson() const;
+  };
+
+  // Called on the calling thread before each frame is recorded. Returning
+  // false cancels the export.
+  using ProgressCallback = std::function<bool(int frame)>;
+
+  FrameExporter(Scene &scene, const Settings &settings);
+
+  Result run(FrameSink &sink, const ProgressCallback &progress = {});
+
+  // Scales a `srcWidth` x `srcHeight` view to fit `width` x `height` pixels,
+  // centered and preserving the aspect ratio.
+  static SkMatrix fitTransform(float srcWidth, float srcHeight, int width,
+                               int height);
+
+  // Replays `picture` into `dst` split into `tileSize` squares on `threads`
+  // threads (0 picks QThread::idealThreadCount()). Each tile renders straight
+  // into its part of `dst`. Record the picture with an R-tree so tiles skip
+  // operations that miss them.
+  static void rasterizeTiled(const SkPicture &picture, const SkPixmap &dst,
+                             SkColor clearColor, int threads = 0,
+                             int tileSize = 256);
+
+private:
+  Scene &scene_;
+  Settings settings_;
+};
@@ -0,0 +1,48 @@
+#pragma once
+
+#include "profiler.h"
+
+#include <QString>
+
+#include <cstdint>
+
+// Always-on record of recent editor frames for hitches that are gone by the
+// time a profiler is attached. It reads the frame profiler's ring; when a
+// frame goes over budget, the frames of the last `windowSeconds` are written
+// to a JSON file together with the slow frame's scene revision and timeline
+// time. A window longer than the ring holds at the current frame rate is cut
+// short; the file records how much it actually covers. After a dump, the next
+// one waits until a whole new window has passed so a run of slow frames
+// produces one file.
+class FlightRecorder {
+public:
+  struct Settings {
+    double budgetMs = 50.0;     // slower updates or paints trigger a dump
+    double windowSeconds = 5.0; // history written with each dump
+    QString directory;          // empty uses <temp>/animator-flight
+  };
+
+  explicit FlightRecorder(const FrameSampleRing &samples)
+      : samples_(samples) {}
+
+  void setSettings(const Settings &settings) { settings_ = settings; }
+  const Settings &settings() const { return settings_; }
+
+  // Time the playback timer spent simulating the frame in flight.
+  void noteUpdate(double ms) { updateMs_ += ms; }
+  // Checks the frame FrameProfiler::endFrame just committed. Returns the path
+  // of the dump written for it, or an empty string.
+  QString frameEnded(double paintMs);
+
+  int dumpsWritten() const { return dumps_; }
+
+private:
+  QString dump(const char *reason, double ms);
+
+  const FrameSampleRing &samples_;
+  Settings settings_;
+  double updateMs_ = 0;
+  uint64_t lastFrame_ = UINT64_MAX;
+  double lastDumpWallMs_ = -1;
+  int dumps_ = 0;
+};
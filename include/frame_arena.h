@@ -0,0 +1,104 @@
+#pragma once
+
+#include <flecs.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
+#include <optional>
+#include <vector>
+
+// Bump allocator for data that dies with the frame: scratch containers of
+// the engine and of C++ scripts. Allocating is a pointer bump and freeing is
+// a no-op; everything is released at once when the frame ends, after paintGL
+// in the editor and after each recorded frame of an export. A frame that
+// outgrows the buffer takes the rest from the heap, and the next reset
+// enlarges the buffer, so steady-state frames stay off the heap.
+//
+// Use it through std::pmr containers:
+//
+//   FrameArena::vector<SkPoint> points(&arena);
+//
+// Nothing allocated from it may be kept past the end of the frame. It is
+// not thread-safe and belongs to the thread that draws the scene.
+class FrameArena : public std::pmr::memory_resource {
+public:
+  template <typename T> using vector = std::pmr::vector<T>;
+
+  explicit FrameArena(size_t initialBytes = 64 << 10) {
+    allocateBuffer(initialBytes);
+  }
+  FrameArena(const FrameArena &) = delete;
+  FrameArena &operator=(const FrameArena &) = delete;
+
+  // Releases everything allocated since the last reset. If the buffer ran
+  // out, padding included, it is replaced by a larger one.
+  void reset() {
+    peak_ = std::max(peak_, used_);
+    if (overflow_.allocations > 0)
+      allocateBuffer(std::max(capacity_ * 2, used_ + used_ / 2));
+    else
+      resource_->release();
+    overflow_.allocations = 0;
+    used_ = 0;
+  }
+
+  // Requested bytes since the last reset, without alignment padding.
+  size_t bytesUsed() const { return used_; }
+  size_t capacity() const { return capacity_; }
+  size_t peakBytes() const { return std::max(peak_, used_); }
+
+private:
+  // Upstream of the buffer: the heap, counting how often the buffer ran out.
+  class Overflow : public std::pmr::memory_resource {
+  public:
+    size_t allocations = 0; // since the last reset
+
+  private:
+    void *do_allocate(size_t bytes, size_t alignment) override {
+      ++allocations;
+      return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+    }
+    void do_deallocate(void *p, size_t bytes, size_t alignment) override {
+      std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+    }
+    bool do_is_equal(const std::pmr::memory_resource &other) const
+        noexcept override {
+      return this == &other;
+    }
+  };
+
+  void allocateBuffer(size_t bytes) {
+    resource_.reset(); // it may still hold overflow blocks
+    buffer_.reset(new std::byte[bytes]);
+    capacity_ = bytes;
+    resource_.emplace(buffer_.get(), capacity_, &overflow_);
+  }
+
+  void *do_allocate(size_t bytes, size_t alignment) override {
+    used_ += bytes;
+    return resource_->allocate(bytes, alignment);
+  }
+  void do_deallocate(void *, size_t, size_t) override {}
+  bool do_is_equal(const std::pmr::memory_resource &other) const
+      noexcept override {
+    return this == &other;
+  }
+
+  std::unique_ptr<std::byte[]> buffer_;
+  size_t capacity_ = 0;
+  Overflow overflow_; // outlives resource_, which returns its blocks here
+  std::optional<std::pmr::monotonic_buffer_resource> resource_;
+  size_t used_ = 0, peak_ = 0;
+};
+
+// The scene's arena as a world singleton. C++ scripts only get the world, so
+// this is how they reach it.
+struct FrameArenaSingleton {
+  FrameArena *arena = nullptr;
+};
+
+inline FrameArena &frameArena(const flecs::world &world) {
+  return *world.get<FrameArenaSingleton>().arena;
+}
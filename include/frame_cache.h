@@ -0,0 +1,52 @@
+#pragma once
+
+#include "include/core/SkPicture.h"
+
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+
+// Whole-scene recordings for timeline scrubbing. Each frame is an SkPicture
+// recorded in world space, so it replays under any view matrix and only needs
+// re-recording when the scene changes. Entries are keyed by the timeline time
+// rounded to `timeStep` and belong to one scene revision; looking up a newer
+// revision drops everything. The least recently used frames are evicted once
+// the pictures exceed the memory budget.
+class FrameCache {
+public:
+  explicit FrameCache(size_t budgetBytes = 256 << 20, float timeStep = 0.01f);
+
+  // Frames are recorded at the start of their step, so a hit shows the scene
+  // at timeOf(tickOf(time)).
+  int64_t tickOf(float time) const;
+  float timeOf(int64_t tick) const { return tick * timeStep_; }
+
+  sk_sp<SkPicture> find(int64_t tick, uint64_t revision);
+  bool contains(int64_t tick, uint64_t revision) const {
+    return revision == revision_ && entries_.count(tick) != 0;
+  }
+  void insert(int64_t tick, uint64_t revision, sk_sp<SkPicture> picture);
+  void clear();
+
+  void setBudget(size_t bytes);
+  size_t budget() const { return budget_; }
+  size_t bytesUsed() const { return bytesUsed_; }
+  size_t size() const { return entries_.size(); }
+
+private:
+  struct Entry {
+    sk_sp<SkPicture> picture;
+    size_t bytes = 0;
+    std::list<int64_t>::iterator lruPos;
+  };
+
+  void syncRevision(uint64_t revision);
+  void evictToBudget();
+
+  size_t budget_;
+  float timeStep_;
+  uint64_t revision_ = 0;
+  size_t bytesUsed_ = 0;
+  std::unordered_map<int64_t, Entry> entries_;
+  std::list<int64_t> lru_; // most recently used first
+};
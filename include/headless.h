@@ -0,0 +1,10 @@
+#pragma once
+
+// Command-line rendering without a display or GPU. Loads a scene JSON, renders
+// a time range through FrameExporter on raster surfaces and writes an MP4 or an
+// image sequence, then prints a JSON timing summary. Run with `--headless
+// --help` for the options.
+int runHeadless(int argc, char **argv);
+
+// True when argv asks for headless mode, i.e. contains `--headless`.
+bool isHeadlessInvocation(int argc, char **argv);
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QJsonObject>
+#include <QString>
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Scene;
+
+// Heap estimates for standard containers. They count what the container
+// allocates itself, not what its elements own.
+template <typename T> size_t vectorBytes(const std::vector<T> &v) {
+  return v.capacity() * sizeof(T);
+}
+template <typename Map> size_t hashMapBytes(const Map &map) {
+  // One node per element (value, next pointer, cached hash) and the buckets.
+  return map.size() * (sizeof(typename Map::value_type) + 2 * sizeof(void *)) +
+         map.bucket_count() * sizeof(void *);
+}
+inline size_t stringBytes(const std::string &s) {
+  // Short strings live inside the object.
+  return s.capacity() > 15 ? s.capacity() + 1 : 0;
+}
+
+// Approximate memory use broken down into sections: flecs component storage,
+// heap owned by components, shapes and their cached paths by kind, and the
+// caches and interpreters around the scene. Sections do not overlap, so
+// their sum is the total. Figures are estimates from container sizes and
+// library counters, not allocator statistics: good for sizing machines and
+// spotting growth between two reports, not for exact accounting.
+struct MemoryReport {
+  struct Entry {
+    std::string name;
+    uint64_t count = 0; // entities, objects or cache entries
+    uint64_t bytes = 0;
+  };
+  struct Section {
+    std::string title;
+    std::vector<Entry> entries;
+
+    void add(const std::string &name, uint64_t count, uint64_t bytes);
+    uint64_t bytes() const;
+  };
+
+  std::vector<Section> sections;
+
+  // The section with `title`, created on first use.
+  Section &section(const std::string &title);
+  uint64_t totalBytes() const;
+
+  QJsonObject toJson() const;
+  // Plain text table, largest entries first.
+  QString toText() const;
+};
+
+// Measures everything the scene owns, plus the process-wide Skia CPU caches.
+// Editor-only memory (undo stack, frame cache, GPU resources) is added by the
+// caller into the "editor" section.
+MemoryReport measureSceneMemory(Scene &scene);
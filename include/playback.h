@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QElapsedTimer>
+
+#include <cstdint>
+
+// Timeline clock for interactive playback. Real time is read from a monotonic
+// clock and turned into a whole number of fixed simulation steps, so scripts
+// see the same dt however fast frames are drawn. When frames take longer than
+// a step, several steps run before the next frame and the skipped frames are
+// counted as dropped. After a long stall, at most `maxStepsPerFrame` steps
+// catch up and the timeline falls behind real time instead of spiralling.
+class PlaybackClock {
+public:
+  struct Stats {
+    uint64_t framesShown = 0;
+    uint64_t framesDropped = 0; // steps simulated but never displayed
+    uint64_t stepsSkipped = 0;  // steps given up by the catch-up cap
+    double wallSeconds = 0;     // real time spent playing
+    double timelineSeconds = 0; // timeline time advanced while playing
+  };
+
+  explicit PlaybackClock(double step = 1.0 / 60.0, int maxStepsPerFrame = 4);
+
+  void start();
+  void pause();
+  bool isRunning() const { return running_; }
+
+  // Called once per displayed frame; returns how many steps to simulate.
+  int advance();
+
+  double step() const { return step_; }
+  const Stats &stats() const { return stats_; }
+  void resetStats() { stats_ = {}; }
+
+private:
+  double step_;
+  int maxStepsPerFrame_;
+  QElapsedTimer timer_;
+  int64_t lastNanos_ = 0;
+  double accumulator_ = 0; // real seconds not yet simulated
+  bool running_ = false;
+  Stats stats_;
+};
@@ -0,0 +1,196 @@
+#pragma once
+
+#include "alloc_tracker.h"
+#include "flecs.h"
+#include "trace.h"
+
+#include <QElapsedTimer>
+
+#include <atomic>
+#include <cstdint>
+#include <vector>
+
+// Parts of an editor frame, in the order they run.
+enum class FramePhase : int {
+  LuaTick,       // ScriptSystem::tick
+  WorldProgress, // world->progress, without the C++ script system
+  CppUpdate,     // IScript::on_update, run by a flecs system
+  Render,        // RenderSystem::render
+  CppDraw,       // IScript::on_draw
+  Flush,         // GrDirectContext::flushAndSubmit
+  Count
+};
+constexpr int kFramePhaseCount = static_cast<int>(FramePhase::Count);
+const char *framePhaseName(FramePhase phase);
+
+// One flecs system as seen in a single frame.
+struct SystemSample {
+  char name[32] = {};
+  float ms = 0.f;
+  int32_t entities = 0; // entities its query matched
+};
+
+// Everything recorded about one frame. Trivially copyable so the ring buffer
+// can hand out copies without locking.
+struct FrameSample {
+  static constexpr int kMaxSystems = 8;
+
+  uint64_t frame = 0;
+  double wallMs = 0;   // end of the frame, since the profiler was created
+  uint64_t revision = 0;       // Scene::revision() when it was drawn
+  float timelineSeconds = 0.f; // timeline time it showed
+  float phaseMs[kFramePhaseCount] = {};
+  float totalMs = 0.f; // paintGL wall time plus the updates before it
+  uint32_t entitiesDrawn = 0, entitiesReplayed = 0, entitiesCulled = 0;
+  uint32_t luaCalls = 0, cppCalls = 0; // script callbacks run
+  int32_t systemCount = 0; // 0 unless system timing is on
+  SystemSample systems[kMaxSystems];
+  // Allocations, 0 unless AllocTracker is on. The totals cover the GUI
+  // thread from the previous frame's end, so they include Qt event handling
+  // the phases do not.
+  uint32_t phaseAllocs[kFramePhaseCount] = {};
+  uint32_t phaseAllocBytes[kFramePhaseCount] = {};
+  uint32_t allocs = 0, luaAllocs = 0; // luaAllocs is part of allocs
+  uint64_t allocBytes = 0, luaAllocBytes = 0;
+
+  float phaseMsOf(FramePhase phase) const {
+    return phaseMs[static_cast<int>(phase)];
+  }
+};
+
+// Fixed-size ring of frame samples with one writer (the GUI thread) and any
+// number of readers. The writer never waits: it fills the next slot and then
+// publishes it by bumping `head_`. Readers copy a range and then re-read the
+// head; slots the writer may have reused meanwhile, and the slot it may be
+// filling, are dropped from the copy. So a read of the whole ring returns at
+// most kCapacity - 1 samples.
+class FrameSampleRing {
+public:
+  // About 8 s at the editor's 125 Hz repaint rate, more than the flight
+  // recorder's default window.
+  static constexpr size_t kCapacity = 1024;
+
+  void push(const FrameSample &sample);
+  // Up to `count` of the newest samples, oldest first.
+  std::vector<FrameSample> recent(size_t count) const;
+  uint64_t pushed() const { return head_.load(std::memory_order_acquire); }
+
+private:
+  FrameSample slots_[kCapacity];
+  std::atomic<uint64_t> head_{0}; // number of samples ever pushed
+};
+
+// Per-frame timings of the editor loop. Phases are accumulated by Scope
+// objects while a frame is in flight and committed by endFrame(), which the
+// canvas calls at the end of paintGL. An enabled Scope reads the clock
+// twice, cheap enough for the editor to keep it on all the time; per-system
+// timing makes flecs measure every system and is switched on separately.
+// Scopes are also recorded as trace spans while the Tracer is on, whether
+// or not profiling is, and count the allocations made inside them while the
+// AllocTracker is on.
+class FrameProfiler {
+public:
+  class Scope {
+  public:
+    Scope(FrameProfiler &profiler, FramePhase phase)
+        : span_("frame", framePhaseName(phase)),
+          profiler_(profiler.enabled() ? &profiler : nullptr), phase_(phase) {
+      if (profiler_) {
+        timer_.start();
+        allocs_ = AllocTracker::counts();
+      }
+    }
+    ~Scope() {
+      if (!profiler_)
+        return;
+      profiler_->addPhaseTime(phase_, timer_.nsecsElapsed() / 1e6);
+      profiler_->addPhaseAllocs(phase_, AllocTracker::counts() - allocs_);
+    }
+    Scope(const Scope &) = delete;
+    Scope &operator=(const Scope &) = delete;
+
+  private:
+    TraceSpan span_;
+    FrameProfiler *profiler_;
+    FramePhase phase_;
+    QElapsedTimer timer_;
+    AllocCounts allocs_;
+  };
+
+  // Keeps work outside the editor loop, like prefetching or export frames,
+  // out of the current frame's timings.
+  class Suspend {
+  public:
+    explicit Suspend(FrameProfiler &profiler)
+        : profiler_(profiler), was_(profiler.enabled_),
+          luaCalls_(profiler.luaCalls_), allocs_(AllocTracker::counts()) {
+      profiler_.enabled_ = false;
+    }
+    ~Suspend() {
+      profiler_.enabled_ = was_;
+      profiler_.lastLuaCalls_ += profiler_.luaCalls_ - luaCalls_;
+      profiler_.lastAllocs_ += AllocTracker::counts() - allocs_;
+    }
+    Suspend(const Suspend &) = delete;
+    Suspend &operator=(const Suspend &) = delete;
+
+  private:
+    FrameProfiler &profiler_;
+    bool was_;
+    uint64_t luaCalls_;
+    AllocCounts allocs_;
+  };
+
+  // `luaCalls` is the running count of Lua calls, ScriptingEngine::callCount.
+  FrameProfiler(flecs::world &world, const uint64_t &luaCalls)
+      : world_(world), luaCalls_(luaCalls) {
+    clock_.start();
+  }
+
+  void setEnabled(bool enabled);
+  bool enabled() const { return enabled_; }
+  void setSystemTimingEnabled(bool enabled);
+  bool systemTimingEnabled() const { return systemTiming_; }
+
+  void addPhaseTime(FramePhase phase, double ms);
+  // Adds `ms` to one phase and takes it back out of another that encloses
+  // it, e.g. C++ script updates out of world->progress.
+  void movePhaseTime(FramePhase from, FramePhase to, double ms);
+  void addPhaseAllocs(FramePhase phase, const AllocCounts &allocs);
+  void movePhaseAllocs(FramePhase from, FramePhase to,
+                       const AllocCounts &allocs);
+  void countCppCall() {
+    if (enabled_)
+      ++cppCalls_;
+  }
+
+  // What the canvas knows about the frame it just drew.
+  struct FrameInfo {
+    uint32_t drawn = 0, replayed = 0, culled = 0; // renderer frame counters
+    uint64_t revision = 0;
+    float timelineSeconds = 0.f;
+  };
+  // Closes the current frame and starts the next one. `paintMs` is the wall
+  // time of paintGL; the update phases before it are added on top.
+  void endFrame(double paintMs, const FrameInfo &info);
+
+  const FrameSampleRing &samples() const { return ring_; }
+
+private:
+  void sampleSystems(FrameSample &sample);
+
+  flecs::world &world_;
+  const uint64_t &luaCalls_;
+  bool enabled_ = false;
+  bool systemTiming_ = false;
+  QElapsedTimer clock_;
+  uint64_t frame_ = 0;
+  double pending_[kFramePhaseCount] = {};
+  AllocCounts pendingAllocs_[kFramePhaseCount];
+  AllocCounts lastAllocs_; // AllocTracker::counts() at the last frame end
+  uint32_t cppCalls_ = 0;
+  uint64_t lastLuaCalls_ = 0;
+  // Cumulative flecs time_spent per system at the previous frame.
+  std::vector<std::pair<flecs::entity_t, double>> lastSystemTime_;
+  FrameSampleRing ring_;
+};
@@ -3,14 +3,161 @@
 #include "scripting.h"
 #include "shapes.h"
 
+#include "include/core/SkImage.h"
+#include "include/core/SkPicture.h"
+#include "include/core/SkRSXform.h"
+
+#include <unordered_map>
+
 class RenderSystem {
 public:
-  explicit RenderSystem(flecs::world &w, ScriptSystem &ss)
-      : world_(w), scriptSystem_(ss) {}
+  explicit RenderSystem(flecs::world &w, ScriptSystem &ss);
 
   void render(SkCanvas *canvas, float currentTime);
 
+  // Picture cache and culling counters. `frame*` fields describe the last render() call,
+  // the others accumulate until resetStats().
+  struct Stats {
+    uint64_t pictureHits = 0, pictureMisses = 0;
+    uint32_t frameHits = 0, frameMisses = 0;
+    uint32_t frameEntitiesReplayed = 0, frameEntitiesDrawn = 0;
+    uint32_t frameEntitiesCulled = 0;
+    uint32_t frameScriptedEntities = 0; // entities with a Lua draw function
+    // Entity draws issued this frame, live or into a new recording, before
+    // and after merging same-paint neighbours into one path.
+    uint32_t frameDrawsUnbatched = 0, frameDrawsBatched = 0;
+    uint32_t frameInstancesDrawn = 0; // InstancedShapeComponent instances
+
+    float hitRate() const {
+      const uint64_t total = pictureHits + pictureMisses;
+      return total ? static_cast<float>(pictureHits) / total : 0.f;
+    }
+  };
+  const Stats &stats() const { return stats_; }
+  void resetStats() { stats_ = {}; }
+
+  // Drop every recorded picture, e.g. after the scene was reloaded.
+  void clearPictureCache() {
+    pictureCache_.clear();
+    otherPictureCache_.clear();
+  }
+  size_t pictureCacheSize() const {
+    return pictureCache_.size() + otherPictureCache_.size();
+  }
+  size_t pictureCacheBytes() const;
+  size_t spriteCacheSize() const {
+    return sprites_.size() + otherSprites_.size();
+  }
+  size_t spriteCacheBytes() const;
+
+  // Draft quality skips anti-aliasing and path effects, for interactive
+  // previews that cannot keep up. Script draw functions are unaffected.
+  void setDraftQuality(bool draft) { draft_ = draft; }
+  bool draftQuality() const { return draft_; }
+
+  // Level of detail from the canvas matrix, see Shape::render. Turn it off
+  // when the output is replayed at other scales, e.g. frame cache pictures.
+  void setLevelOfDetail(bool enabled) { lodEnabled_ = enabled; }
+
+  // Offscreen renders, e.g. frames recorded ahead of the playhead, get their
+  // own picture and sprite caches and stats, so they neither evict what the
+  // editor view uses nor overwrite the stats it reads. stats() describes the
+  // offscreen frames until this is turned off again.
+  void setOffscreen(bool offscreen);
+
 private:
+  // Draw queue: matched once by flecs and kept up to date as entities gain or
+  // lose components, so a frame only walks the tables that can be drawn.
+  // Single and instanced shapes share one query so they keep scene order.
+  using DrawQuery =
+      flecs::query<const TransformComponent, const ShapeComponent *,
+                   const InstancedShapeComponent *, const MaterialComponent,
+                   PaintCacheComponent, RenderVersionComponent,
+                   const WorldBoundsComponent, const AnimationComponent *,
+                   const PathEffectComponent *, ScriptComponent *,
+                   const CppScriptComponent *>;
+
+  // One visible entity of the current frame, in draw order.
+  struct DrawItem {
+    flecs::entity_t id;
+    const TransformComponent *transform;
+    const Shape *shape;
+    const InstancedShapeComponent *instances; // null for a single shape
+    const PaintCacheComponent *paints;
+    ScriptComponent *script; // only set when the script has a draw function
+    uint32_t version;
+    SkRect bounds; // world space
+    float outset;  // how far drawing reaches past the shape, local units
+    bool isStatic;
+    bool isVisible; // world bounds intersect the canvas clip
+  };
+
+  struct CachedPicture {
+    sk_sp<SkPicture> picture;
+    uint64_t lastUsedFrame = 0;
+  };
+
+  // A white rendering of an instanced shape, tinted per instance by
+  // drawAtlas. Rebuilt when the zoom bucket, paint or geometry changes.
+  struct InstanceSprite {
+    sk_sp<SkImage> image;
+    uint32_t geometryGeneration = 0;
+    SkPaint paint;
+    sk_sp<SkPathEffect> pathEffect;
+    float pixelsPerUnit = 0.f;
+    SkPoint anchor = {0.f, 0.f}; // the shape's origin in sprite pixels
+    uint64_t lastUsedFrame = 0;
+  };
+
+  void collect(const DrawQuery &q, float currentTime, const SkRect &clip);
+  void drawItem(SkCanvas *canvas, const DrawItem &item);
+  void drawInstances(SkCanvas *canvas, const DrawItem &item,
+                     const PaintCacheComponent &paints, float pixelScale);
+  const InstanceSprite *instanceSprite(const DrawItem &item,
+                                       const PaintCacheComponent &paints,
+                                       float pixelsPerUnit);
+  // Draws drawList_[begin, end), merging runs of compatible items. With
+  // `cull`, items outside the clip are skipped and counted.
+  void drawItems(SkCanvas *canvas, size_t begin, size_t end, bool cull);
+  bool canBatch(const DrawItem &item) const;
+  // Winding sign of the item's merged contours, or 0 when overlapping it
+  // with others in one path could change its pixels.
+  int mergeWinding(const DrawItem &item) const;
+  bool fitsBatch(const DrawItem &item) const;
+  void addToBatch(size_t index);
+  void flushBatch(SkCanvas *canvas);
+  void drawStaticRun(SkCanvas *canvas, size_t begin, size_t end);
+  float pixelScaleOf(const DrawItem &item) const;
+
   flecs::world &world_;
   ScriptSystem &scriptSystem_;
+  DrawQuery backgroundQuery_;
+  DrawQuery foregroundQuery_;
+
+  // Reused every frame; capacity is kept so steady state does not allocate.
+  std::vector<DrawItem> drawList_;
+  std::vector<size_t> batch_; // drawList_ indices waiting to be merged
+  SkRect batchBounds_ = SkRect::MakeEmpty(); // union of the batch's bounds
+  int batchWinding_ = 0; // shared mergeWinding() of the batch, or 0
+  SkPath batchPath_;
+  // Runs of consecutive static entities keyed by their members and versions.
+  std::unordered_map<uint64_t, CachedPicture> pictureCache_;
+  std::unordered_map<flecs::entity_t, InstanceSprite> sprites_;
+  std::vector<SkRSXform> xforms_;
+  std::vector<SkRect> spriteRects_;
+  std::vector<SkColor> instanceColors_;
+  PaintCacheComponent instancePaints_; // scratch copy for per-instance colors
+  uint64_t frameCounter_ = 0;
+  Stats stats_;
+  // The caches and stats of the other mode, swapped in by setOffscreen().
+  bool offscreen_ = false;
+  std::unordered_map<uint64_t, CachedPicture> otherPictureCache_;
+  std::unordered_map<flecs::entity_t, InstanceSprite> otherSprites_;
+  uint64_t otherFrameCounter_ = 0;
+  Stats otherStats_;
+
+  bool draft_ = false;
+  PaintCacheComponent draftPaints_; // scratch copy used in draft quality
+  bool lodEnabled_ = true;
+  float viewScale_ = 0.f; // device pixels per world unit; 0 = exact geometry
 };
@@ -1,8 +1,11 @@
 #pragma once
 
 #include "ecs.h"
+#include "frame_arena.h"
+#include "profiler.h"
 #include "qglobal.h"
 #include "render.h"
+#include "spatial_index.h"
 #include "scripting.h"
 
 #include "cpp_script_interface.h"
@@ -53,6 +56,20 @@ public:
 
   RenderSystem &getRenderer() { return renderer; }
 
+  SpatialIndex &getSpatialIndex() { return spatialIndex; }
+
+  // Phase timings of update() and draw(); off until the editor enables it.
+  FrameProfiler &profiler() { return profiler_; }
+
+  // Scratch memory for the frame being drawn; whoever ends a frame (the
+  // canvas, the exporter) resets it. Scripts find it through
+  // FrameArenaSingleton.
+  FrameArena &frameArena() { return frameArena_; }
+
+  // Bumped whenever a component that affects the rendered picture is set,
+  // flagged with modified<>() or removed. Never decreases.
+  uint64_t revision() const { return revision_; }
+
   // Expose world for editor loops ---------------------------------------
   flecs::world &ecs() { return *world; }
   const flecs::world &ecs() const { return *world; }
@@ -69,6 +86,8 @@ public:
   }
 
 private:
+  template <typename T> void trackRevision();
+
   // Unique‑name helper
   std::string uniqueName(const std::string &base) {
     int &counter = kindCounters[base];
@@ -80,6 +99,7 @@ private:
   }
 
   // Flecs data ----------------------------------------------------------
+  FrameArena frameArena_; // before the world, which points to it
   std::unique_ptr<flecs::world> world;
 
   struct TimeSingleton {
@@ -90,7 +110,11 @@ private:
   ScriptingEngine scriptingEngine;
   ScriptSystem scriptSystem;
   RenderSystem renderer;
+  SpatialIndex spatialIndex;
+  FrameProfiler profiler_;
 
   // Name uniqueness map -------------------------------------------------
   std::unordered_map<std::string, int> kindCounters;
+
+  uint64_t revision_ = 0;
 };
@@ -32,3 +32,4 @@
 // Engine Headers
 #include "cpp_script_interface.h"
 #include "ecs.h"
+#include "frame_arena.h"
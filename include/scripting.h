@@ -1,6 +1,7 @@
 #pragma once
 
 #include "ecs.h"
+#include "trace.h"
 #include <QCoreApplication>
 #include <QDebug>
 #include <QFileInfo>
@@ -19,11 +20,27 @@ public:
   void call(sol::table &env, const std::string &fn, float dt = 0.f,
             float t = 0.f);
   void call_draw(sol::table &env, const std::string &fn, SkCanvas *canvas);
+  // Lua functions called through call() and call_draw() so far.
+  const uint64_t &callCount() const { return callCount_; }
+  // Bytes allocated by the Lua state, as lua_gc reports them.
+  size_t heapBytes() const;
 
 private:
+  // Components handed to Lua by mutable reference are flagged with
+  // modified<>() once the call returns so OnSet observers see the change.
+  void commitModified();
+  // Lua allocator that reports to AllocTracker and forwards to the default.
+  static void *trackingAlloc(void *ud, void *ptr, size_t osize, size_t nsize);
+
+  lua_Alloc baseAlloc_ = nullptr;
+  void *baseAllocUd_ = nullptr;
   sol::state lua_;
   flecs::world &world_;
   SkiaCanvasWidget *canvas_;
+  std::vector<Entity> modifiedMaterials_;
+  std::vector<Entity> modifiedTransforms_;
+  std::vector<Entity> modifiedInstances_;
+  uint64_t callCount_ = 0;
 };
 
 // ----------------------------------------------------------------------------
@@ -61,6 +78,8 @@ public:
 
       if (sc.scriptEnv.valid()) {
         if (sc.scriptEnv[sc.updateFunction].valid()) {
+          TraceSpan span("lua", "on_update", "entity", e.id(),
+                         Tracer::Level::Entities);
           engine_.call(sc.scriptEnv, sc.updateFunction, dt, currentTime);
         } else {
           qWarning() << "Update function '" << sc.updateFunction.c_str()
@@ -91,6 +91,17 @@ inline QJsonObject serializeEntity(const Scene &, Entity e) {
   if (e.has<SceneBackgroundComponent>())
     o["SceneBackgroundComponent"] = true;
 
+  // Instanced shape: the instances themselves are written by scripts -------
+  if (e.has<InstancedShapeComponent>()) {
+    auto &is = e.get<InstancedShapeComponent>();
+    if (is.shape) {
+      QJsonObject j;
+      j["kind"] = is.shape->getKindName();
+      j["properties"] = is.shape->serialize();
+      o["InstancedShapeComponent"] = j;
+    }
+  }
+
   // Shape -----------------------------------------------------------------
   if (e.has<ShapeComponent>()) {
     auto &sh = e.get<ShapeComponent>();
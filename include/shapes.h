@@ -3,6 +3,7 @@
 // Forward declarations to break circular dependency with ecs.h
 struct MaterialComponent;
 struct PathEffectComponent;
+struct PaintCacheComponent;
 
 #include <QDoubleSpinBox>
 #include <QFormLayout>
@@ -19,6 +20,7 @@ struct PathEffectComponent;
 #include "include/core/SkPoint.h"
 #include "include/core/SkRect.h"
 
+#include <array>
 #include <cmath>
 #include <functional>
 #include <memory>
@@ -41,14 +43,41 @@ class Shape {
 public:
   virtual ~Shape() = default;
 
+  // `pixelScale` is the number of device pixels per local unit. When it is
+  // positive, shapes that cover few pixels are simplified: tiny ones draw
+  // their bounds, small ones skip path effects and draw curves as cached
+  // polylines. 0 always draws the exact geometry.
+  void render(SkCanvas *canvas, const PaintCacheComponent &paints,
+              float pixelScale = 0.f) const;
+
+  // The paths render() draws for `pixelScale`, or nullptr when the shape is
+  // small enough to draw only its bounding box.
+  const std::vector<StyledPath> *
+  pathsToDraw(const PaintCacheComponent &paints, float pixelScale) const;
+
+  // True when every path uses the material's style and the winding fill
+  // rule, so copies of the shape can be merged into one path and drawn with
+  // a single paint.
+  bool canMergePaths() const {
+    ensurePaths();
+    for (const auto &styledPath : m_paths)
+      if (styledPath.style ||
+          styledPath.path.getFillType() != SkPathFillType::kWinding)
+        return false;
+    return true;
+  }
+
+  // Sign of the area the paths enclose: +1 when the outer contours run
+  // clockwise (y down), -1 counter-clockwise, 0 for none or mixed. Merged
+  // fills of shapes with the same nonzero sign cover exactly their union.
+  int windingSign() const;
+
+  // Convenience for callers outside the ECS; builds the paints on every call.
   void render(SkCanvas *canvas, const MaterialComponent &material,
               const PathEffectComponent *pathEffect = nullptr) const;
 
   SkRect getBoundingBox() const {
-    if (m_isDirty) {
-      rebuildPaths();
-      m_isDirty = false;
-    }
+    ensurePaths();
     SkRect bounds =
         m_paths.empty() ? SkRect::MakeEmpty() : m_paths[0].path.getBounds();
     for (size_t i = 1; i < m_paths.size(); ++i) {
@@ -57,6 +86,21 @@ public:
     return bounds;
   }
 
+  // True until the paths are rebuilt after a property change.
+  bool isDirty() const { return m_isDirty; }
+
+  // Taken from a global counter whenever the paths are rebuilt, so caches of
+  // rendered geometry can be keyed by it even across shape replacements.
+  uint32_t geometryGeneration() const {
+    ensurePaths();
+    return m_geometryGeneration;
+  }
+
+  // Approximate heap use for memory reports: the object with the data it
+  // owns, and the cached paths (exact, path-effect and level-of-detail).
+  virtual size_t objectBytes() const = 0;
+  size_t pathBytes() const;
+
   virtual const char *getKindName() const = 0;
   virtual QWidget *
   createPropertyEditor(QWidget *parent,
@@ -81,17 +125,45 @@ protected:
   }
 
   const SkPath &getPath() const {
+    ensurePaths();
+    // Return the first path for simple compatibility, though this might not
+    // always be what's needed.
+    return m_paths.front().path;
+  }
+
+  void ensurePaths() const {
     if (m_isDirty) {
       rebuildPaths();
       m_isDirty = false;
+      m_geometryGeneration = ++s_geometryGenerationCounter;
+      m_filteredGeneration = 0;
+      m_lodValid = 0;
+      m_windingSign = kWindingUnknown;
     }
-    // Return the first path for simple compatibility, though this might not
-    // always be what's needed.
-    return m_paths.front().path;
   }
 
+  // m_paths with the entity's path effect already applied. Valid while
+  // m_filteredGeneration matches PaintCacheComponent::filterGeneration.
+  const std::vector<StyledPath> &
+  filteredPaths(const PaintCacheComponent &paints) const;
+
   mutable std::vector<StyledPath> m_paths;
   mutable bool m_isDirty = true;
+  mutable uint32_t m_geometryGeneration = 0;
+  inline static uint32_t s_geometryGenerationCounter = 0;
+
+  mutable std::vector<StyledPath> m_filteredPaths;
+  mutable uint32_t m_filteredGeneration = 0;
+
+  // m_paths with curves flattened for an on-screen size of up to 2^(i+1)
+  // pixels. Bit i of m_lodValid marks bucket i as built.
+  static constexpr int kLodBuckets = 6;
+  const std::vector<StyledPath> &lodPaths(int bucket) const;
+  mutable std::array<std::vector<StyledPath>, kLodBuckets> m_lodPaths;
+  mutable uint32_t m_lodValid = 0;
+
+  static constexpr int kWindingUnknown = 2;
+  mutable int m_windingSign = kWindingUnknown;
 };
 
 //==============================================================================
@@ -118,6 +190,7 @@ protected:
   public:                                                                      \
     ClassName() { markDirty(); } /* Ensure path is built on creation */        \
     const char *getKindName() const override { return KindNameString; }        \
+    size_t objectBytes() const override { return sizeof(ClassName); }          \
     std::unique_ptr<Shape> clone() const override {                            \
       return std::make_unique<ClassName>(*this);                               \
     }                                                                          \
@@ -264,6 +337,10 @@ public:
     markDirty();
   }
   const char *getKindName() const override { return "ArcPolygon"; }
+  size_t objectBytes() const override {
+    return sizeof(*this) + vertices.capacity() * sizeof(SkPoint) +
+           (angles.capacity() + radii.capacity()) * sizeof(float);
+  }
   std::unique_ptr<Shape> clone() const override {
     return std::make_unique<ArcPolygonShape>(*this);
   }
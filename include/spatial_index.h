@@ -0,0 +1,71 @@
+#pragma once
+#include "ecs.h"
+
+#include "include/core/SkRect.h"
+
+#include <functional>
+#include <unordered_map>
+#include <vector>
+
+// Uniform grid over the world-space bounds of every entity with a transform
+// and a shape or instanced shape. Observers keep it current as
+// TransformComponent, ShapeComponent, InstancedShapeComponent,
+// MaterialComponent or PathEffectComponent are set, and mirror
+// each entity's bounds into its WorldBoundsComponent for the renderer.
+class SpatialIndex {
+public:
+  explicit SpatialIndex(flecs::world &w, float cellSize = 256.f);
+
+  // Entities whose bounds intersect `rect` (or contain `pt`), each reported
+  // once and in no particular order. `out` is cleared first.
+  void query(const SkRect &rect, std::vector<flecs::entity_t> &out) const;
+  void query(const SkPoint &pt, std::vector<flecs::entity_t> &out) const;
+
+  // Recompute an entity's bounds, e.g. after its shape was edited in place.
+  void update(flecs::entity e);
+  // Like update(), but leaves the entry alone when the bounds did not change,
+  // for entities polled every frame.
+  void refresh(flecs::entity e);
+
+  size_t size() const { return entries_.size(); }
+  size_t bytesUsed() const;
+
+  // Called with the previous and the new bounds whenever an entry is updated
+  // or removed, so views can repaint just the affected areas.
+  void setDamageListener(std::function<void(const SkRect &)> listener) {
+    damageListener_ = std::move(listener);
+  }
+
+private:
+  struct Entry {
+    SkRect bounds;
+    int x0 = 0, y0 = 0, x1 = -1, y1 = -1; // covered cells, inclusive
+    bool oversized = false;
+    mutable uint32_t queryStamp = 0;
+  };
+
+  // False when the entity has nothing to index.
+  bool computeBounds(flecs::entity e, SkRect &bounds) const;
+  void insert(flecs::entity_t id, const SkRect &bounds);
+  void remove(flecs::entity_t id);
+  void link(flecs::entity_t id, const Entry &entry);
+  void unlink(flecs::entity_t id, const Entry &entry);
+  void gather(const SkRect &rect, bool isPoint,
+              std::vector<flecs::entity_t> &out) const;
+
+  int cellOf(float v) const;
+  static uint64_t cellKey(int x, int y) {
+    return (static_cast<uint64_t>(static_cast<uint32_t>(x)) << 32) |
+           static_cast<uint32_t>(y);
+  }
+
+  flecs::world &world_;
+  float cellSize_;
+  std::unordered_map<flecs::entity_t, Entry> entries_;
+  std::unordered_map<uint64_t, std::vector<flecs::entity_t>> cells_;
+  // Entities spanning too many cells (backgrounds, huge paths) are kept out
+  // of the grid and tested on every query.
+  std::vector<flecs::entity_t> oversized_;
+  mutable uint32_t queryStamp_ = 0;
+  std::function<void(const SkRect &)> damageListener_;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <QString>
+
+#include <atomic>
+#include <cstdint>
+
+// Records timed spans from any thread and writes them as a Chrome trace-event
+// JSON file, which chrome://tracing and ui.perfetto.dev open. Recording is
+// global and off by default; a span then costs one relaxed atomic load. While
+// on, a span costs two clock reads and an append to a per-thread buffer, so
+// it is fine to keep tracing through a whole video export.
+//
+// Span names and categories must be string literals or otherwise outlive the
+// recording: only the pointers are stored.
+class Tracer {
+public:
+  enum class Level {
+    Off,
+    Frames,   // frame phases, script loading and compiles, export stages
+    Entities, // additionally one span per entity script call
+  };
+
+  // Drops anything recorded earlier and starts recording at `level`.
+  static void start(Level level = Level::Frames);
+  // Stops recording and writes the spans recorded since start() to `path`.
+  // Traced work still running on other threads is cut off.
+  static bool stop(const QString &path, QString *error = nullptr);
+
+  static bool active(Level level = Level::Frames) {
+    return level_.load(std::memory_order_relaxed) >= static_cast<int>(level);
+  }
+
+  // Names the calling thread in the trace viewer.
+  static void setThreadName(const char *name);
+
+  // Nanoseconds on the clock spans are measured with.
+  static int64_t now();
+  static void addSpan(const char *category, const char *name, int64_t start,
+                      int64_t end, const char *argName, int64_t arg);
+
+private:
+  static std::atomic<int> level_;
+};
+
+// Records the lifetime of the object as one span. An optional integer
+// argument, e.g. an entity or frame number, is shown with the span.
+class TraceSpan {
+public:
+  TraceSpan(const char *category, const char *name)
+      : TraceSpan(category, name, nullptr, 0) {}
+  TraceSpan(const char *category, const char *name, const char *argName,
+            int64_t arg, Tracer::Level level = Tracer::Level::Frames)
+      : category_(category), name_(name), argName_(argName), arg_(arg),
+        start_(Tracer::active(level) ? Tracer::now() : -1) {}
+  ~TraceSpan() {
+    if (start_ >= 0)
+      Tracer::addSpan(category_, name_, start_, Tracer::now(), argName_,
+                      arg_);
+  }
+  TraceSpan(const TraceSpan &) = delete;
+  TraceSpan &operator=(const TraceSpan &) = delete;
+
+private:
+  const char *category_;
+  const char *name_;
+  const char *argName_;
+  int64_t arg_;
+  int64_t start_; // -1 while not recording
+};
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "canvas.h"
+#include "playback.h"
 #include "scene_model.h"
 #include "toolbox.h"
 
@@ -26,11 +27,14 @@
 #include <QPushButton>
 #include <QSlider>
 #include <QSpinBox>
+#include <QTableWidget>
 #include <QTimer>
 #include <QTreeView>
 #include <QUndoStack>
 #include <QVBoxLayout>
 
+class FrameSink;
+
 class MainWindow : public QMainWindow {
   Q_OBJECT
 public:
@@ -62,6 +66,8 @@ private slots:
   void onOpenFile();
   void onSaveFile();
   void onRenderVideo();
+  void onRenderImageSequence();
+  void onExportFrame();
 
   // Transform updates propagated from canvas
   void onTransformChanged(Entity entity);
@@ -86,9 +92,16 @@ private:
   void createSceneDock();
   void createPropertiesDock();
   void createTimelineDock();
+  void createProfilerDock();
+  void updateProfiling(); // profile while the panel or overlay is shown
+  void refreshProfilerDock();
+  void showMemoryReport();
   void clearLayout(QLayout *layout);
   void resetScene(); // restore snapshot
   void syncTransformEditors(Entity e);
+  bool promptRenderResolution(const QString &title, int &width, int &height);
+  void renderAnimation(FrameSink &sink, int width, int height,
+                       const QString &what);
   template <typename Gadget>
   QWidget *buildGadgetEditor(Gadget &g, QWidget *parent,
                              std::function<void()> onChange);
@@ -106,8 +119,16 @@ private:
   QPushButton *m_playPauseButton = nullptr;
   QPushButton *m_stopResetButton = nullptr;
   QLabel *m_timeDisplayLabel = nullptr;
+  QLabel *m_proxyLabel = nullptr;
   QSlider *m_timelineSlider = nullptr;
+  QDockWidget *m_profilerDock = nullptr;
+  QLabel *m_profilerSummary = nullptr;
+  QTableWidget *m_phaseTable = nullptr;
+  QTableWidget *m_systemTable = nullptr;
+  QTimer *m_profilerRefreshTimer = nullptr;
+  QAction *m_profilerAction = nullptr;
   QTimer *m_animationTimer = nullptr;
+  PlaybackClock m_playbackClock;
   QUndoStack *m_undoStack = nullptr;
 
   // State --------------------------------------------------------------------
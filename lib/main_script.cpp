@@ -100,7 +100,7 @@ public:
   }
 
   void on_draw(flecs::entity entity, flecs::world &world, SkCanvas *canvas) override {
-    auto mobjects_to_draw = get_mobjects_at_time(animation_tracks, current_time);
+    auto mobjects_to_draw = get_mobjects_at_time(animation_tracks, current_time, &frameArena(world));
     for (const auto& m : mobjects_to_draw) {
         draw_mobject(canvas, m);
     }
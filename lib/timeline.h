@@ -4,6 +4,7 @@
 #include "mobject.h"
 #include "animation.h"
 #include "easing.h"
+#include <memory_resource>
 #include <vector>
 
 // Represents a single animation track for a Mobject.
@@ -15,22 +16,39 @@ struct AnimationTrack {
     float duration = 1.0f;
 };
 
-// Calculates the state of all mobjects at a given time.
-// This is a pure function that takes the tracks and time, and returns the rendered mobjects.
-inline std::vector<Mobject> get_mobjects_at_time(const std::vector<AnimationTrack>& tracks, float current_time) {
-    std::vector<Mobject> rendered_mobjects;
+// Appends the state of all mobjects at a given time to `out`, any container of Mobject.
+template <typename Container>
+inline void append_mobjects_at_time(const std::vector<AnimationTrack>& tracks, float current_time, Container& out) {
     for (const auto& track : tracks) {
         float t = 0;
         float anim_time = (current_time - track.start_time) / track.duration;
 
         if (anim_time >= 0.0f && anim_time <= 1.0f) {
             t = track.easing(anim_time);
-            rendered_mobjects.push_back(track.animation(track.mobject, t));
+            out.push_back(track.animation(track.mobject, t));
         } else if (anim_time > 1.0f) {
-            rendered_mobjects.push_back(track.animation(track.mobject, 1.0f));
+            out.push_back(track.animation(track.mobject, 1.0f));
         }
         // If anim_time < 0, the object is not yet visible.
     }
+}
+
+// Calculates the state of all mobjects at a given time.
+// This is a pure function that takes the tracks and time, and returns the rendered mobjects.
+inline std::vector<Mobject> get_mobjects_at_time(const std::vector<AnimationTrack>& tracks, float current_time) {
+    std::vector<Mobject> rendered_mobjects;
+    append_mobjects_at_time(tracks, current_time, rendered_mobjects);
+    return rendered_mobjects;
+}
+
+// Same, with the list stored in `memory`, e.g. the scene's FrameArena, so a draw
+// call does not touch the heap for it. The paths inside still live on Skia's heap
+// (shared with the tracks until an animation changes them).
+inline std::pmr::vector<Mobject> get_mobjects_at_time(const std::vector<AnimationTrack>& tracks, float current_time,
+                                                      std::pmr::memory_resource* memory) {
+    std::pmr::vector<Mobject> rendered_mobjects(memory);
+    rendered_mobjects.reserve(tracks.size());
+    append_mobjects_at_time(tracks, current_time, rendered_mobjects);
     return rendered_mobjects;
 }
 
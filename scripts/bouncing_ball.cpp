@@ -53,6 +53,7 @@ public:
       auto &tc = entity.get_mut<TransformComponent>();
       tc.x = x;
       tc.y = y;
+      entity.modified<TransformComponent>();
     }
   }
 
@@ -17,6 +17,10 @@ local bounds = { width = 400, height = 400 }
 -- The table to hold all our particles
 local particles = {}
 
+-- Flat {x1, y1, x2, y2, ...} array handed to the entity's instances, if it
+-- has an InstancedShapeComponent; reused every frame.
+local positions = {}
+
 -- Helper to create a new particle
 function new_particle(x, y)
     return {
@@ -90,6 +94,7 @@ end
 function on_start(entity_id, registry)
     print("Fluid simulation script started for entity " .. tostring(entity_id))
     particles = {}
+    positions = {}
     -- Create a grid of particles
     local cols = 20
     local rows = math.floor(NUM_PARTICLES / cols)
@@ -107,6 +112,15 @@ function on_update(entity_id, registry, dt, currentTime)
     for i = 1, substeps do
         update_physics(substep_dt)
     end
+
+    -- With instances, the renderer draws every particle in one call.
+    if registry:has_instances(entity_id) then
+        for i, p in ipairs(particles) do
+            positions[2 * i - 1] = p.x
+            positions[2 * i] = p.y
+        end
+        registry:get_instances(entity_id):set_positions(positions)
+    end
 end
 
 function on_draw(entity, registry, canvas)
@@ -119,9 +133,11 @@ function on_draw(entity, registry, canvas)
     -- This script draws in its own container, relative to the entity's position.
     -- The renderer should have already translated the canvas to this entity's transform.
 
-    -- Draw the particles
-    for _, p in ipairs(particles) do
-        canvas:drawCircle(p.x, p.y, PARTICLE_RADIUS * 2, paint)
+    -- Draw the particles, unless they are instances of the entity's shape
+    if not registry:has_instances(entity) then
+        for _, p in ipairs(particles) do
+            canvas:drawCircle(p.x, p.y, PARTICLE_RADIUS * 2, paint)
+        end
     end
 
     -- Draw the container bounds for visualization
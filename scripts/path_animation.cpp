@@ -149,6 +149,7 @@ public:
     transform.x = pos.x();
     transform.y = pos.y();
     transform.rotation = atan2(tan.y(), tan.x());
+    entity.modified<TransformComponent>();
 
     // Center the camera on the entity
     SkPoint center = Camera::get_center();
@@ -6,7 +6,9 @@
 -- Helper function to draw an oval by creating a procedural path.
 function draw_oval(canvas, paint, cx, cy, rx, ry)
     local path = Path.new()
-    local segments = 36
+    -- Enough segments to look round at the oval's on-screen size.
+    local pixels = math.max(rx, ry) * canvas:getScale()
+    local segments = math.max(8, math.min(36, math.ceil(math.sqrt(pixels) * 4)))
     path:moveTo(cx + rx, cy)
     for i = 1, segments do
         local angle = (i / segments) * 2 * math.pi
@@ -0,0 +1,102 @@
+#include "alloc_tracker.h"
+
+#include <cstdlib>
+#include <new>
+
+std::atomic<bool> AllocTracker::enabled_{false};
+
+namespace {
+// Constant-initialized, so it is safe to touch from operator new during
+// static initialization and thread start-up.
+thread_local AllocCounts threadCounts;
+
+void *allocate(size_t size) {
+  AllocTracker::noteNew(size);
+  return std::malloc(size ? size : 1);
+}
+
+void *allocateAligned(size_t size, std::align_val_t alignment) {
+  AllocTracker::noteNew(size);
+  const size_t align = static_cast<size_t>(alignment);
+  // aligned_alloc wants a multiple of the alignment.
+  const size_t rounded = (size + align - 1) / align * align;
+  return std::aligned_alloc(align, rounded ? rounded : align);
+}
+} // namespace
+
+AllocCounts AllocTracker::counts() { return threadCounts; }
+
+void AllocTracker::noteNew(size_t bytes) {
+  if (!enabled())
+    return;
+  ++threadCounts.count;
+  threadCounts.bytes += bytes;
+}
+
+void AllocTracker::noteLua(size_t bytes) {
+  if (!enabled())
+    return;
+  ++threadCounts.luaCount;
+  threadCounts.luaBytes += bytes;
+}
+
+// -------------------------------------------------------------------------
+//  Global operator new/delete
+// -------------------------------------------------------------------------
+// All forms are replaced so that every block is released by the allocator
+// that made it.
+void *operator new(size_t size) {
+  if (void *p = allocate(size))
+    return p;
+  throw std::bad_alloc();
+}
+void *operator new[](size_t size) { return operator new(size); }
+void *operator new(size_t size, const std::nothrow_t &) noexcept {
+  return allocate(size);
+}
+void *operator new[](size_t size, const std::nothrow_t &) noexcept {
+  return allocate(size);
+}
+void *operator new(size_t size, std::align_val_t alignment) {
+  if (void *p = allocateAligned(size, alignment))
+    return p;
+  throw std::bad_alloc();
+}
+void *operator new[](size_t size, std::align_val_t alignment) {
+  return operator new(size, alignment);
+}
+void *operator new(size_t size, std::align_val_t alignment,
+                   const std::nothrow_t &) noexcept {
+  return allocateAligned(size, alignment);
+}
+void *operator new[](size_t size, std::align_val_t alignment,
+                     const std::nothrow_t &) noexcept {
+  return allocateAligned(size, alignment);
+}
+
+void operator delete(void *p) noexcept { std::free(p); }
+void operator delete[](void *p) noexcept { std::free(p); }
+void operator delete(void *p, size_t) noexcept { std::free(p); }
+void operator delete[](void *p, size_t) noexcept { std::free(p); }
+void operator delete(void *p, const std::nothrow_t &) noexcept {
+  std::free(p);
+}
+void operator delete[](void *p, const std::nothrow_t &) noexcept {
+  std::free(p);
+}
+void operator delete(void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete[](void *p, std::align_val_t) noexcept { std::free(p); }
+void operator delete(void *p, size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+void operator delete[](void *p, size_t, std::align_val_t) noexcept {
+  std::free(p);
+}
+void operator delete(void *p, std::align_val_t,
+                     const std::nothrow_t &) noexcept {
+  std::free(p);
+}
+void operator delete[](void *p, std::align_val_t,
+                       const std::nothrow_t &) noexcept {
+  std::free(p);
+}
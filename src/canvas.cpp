@@ -1,74 +1,152 @@
 #include "canvas.h"
+#include "alloc_tracker.h"
+#include "exporter.h"
+
+#include "include/core/SkBBHFactory.h"
+#include "include/core/SkPictureRecorder.h"
+#include "include/ports/SkFontMgr_fontconfig.h"
+
+#include <QElapsedTimer>
+
+#include <cstdio>
+#include <iterator>
+
+namespace {
+// Frames are recorded in world space without culling; the R-tree lets
+// replay skip whatever the current view does not show.
+const SkRect kFrameBounds = SkRect::MakeLTRB(-1e6f, -1e6f, 1e6f, 1e6f);
+
+// Frames recorded on each side of the playhead while idle.
+constexpr int kPrefetchRadius = 60;
+// How long the view has to stay unpainted before prefetching starts.
+constexpr int kPrefetchIdleMs = 200;
+// Keep each idle slice short so input stays responsive.
+constexpr qint64 kPrefetchSliceMs = 4;
+
+// Preview quality steps, from full quality to the cheapest proxy.
+struct ProxyLevel {
+  float scale; // proxy surface size relative to the widget
+  bool draft;  // no anti-aliasing or path effects
+};
+constexpr ProxyLevel kProxyLevels[] = {
+    {1.f, false}, {0.5f, false}, {0.5f, true}, {0.25f, true}};
+constexpr int kMaxProxyLevel = std::size(kProxyLevels) - 1;
+// Full quality returns this long after the last interactive frame.
+constexpr int kProxyIdleMs = 250;
+
+// Profiler overlay, in device pixels at the top-left of the canvas. The
+// graph shows one bar per frame and spans two frame budgets.
+const SkRect kHudRect = SkRect::MakeXYWH(8, 8, 312, 150);
+constexpr int kHudFrames = 150;
+constexpr SkColor kPhaseColors[kFramePhaseCount] = {
+    SkColorSetRGB(0x4c, 0xaf, 0x50), // Lua tick
+    SkColorSetRGB(0x9e, 0x9e, 0x9e), // world progress
+    SkColorSetRGB(0x00, 0xbc, 0xd4), // C++ update
+    SkColorSetRGB(0xff, 0x98, 0x00), // render
+    SkColorSetRGB(0x9c, 0x27, 0xb0), // C++ draw
+    SkColorSetRGB(0xf4, 0x43, 0x36), // flush
+};
+
+// Local bounds for picking and selection; instanced shapes act as a whole.
+SkRect localBounds(flecs::entity e) {
+  if (const auto *sc = e.try_get<ShapeComponent>(); sc && sc->shape)
+    return sc->shape->getBoundingBox();
+  if (const auto *instances = e.try_get<InstancedShapeComponent>())
+    return instances->bounds();
+  return SkRect::MakeEmpty();
+}
+} // namespace
 
 void SkiaCanvasWidget::setSelectedEntity(Entity entity) {
-  selectedEntities_.clear();
+  clearSelection();
   if (entity != kInvalidEntity)
-    selectedEntities_.append(entity);
+    select(entity);
 
   update();
   emit canvasSelectionChanged(selectedEntities_);
 }
 
 void SkiaCanvasWidget::setSelectedEntities(const QList<Entity> &entities) {
-  selectedEntities_ = entities;
+  clearSelection();
+  for (Entity e : entities)
+    if (!isSelected(e))
+      select(e);
   update();
   emit canvasSelectionChanged(selectedEntities_);
 }
 
+void SkiaCanvasWidget::select(Entity entity) {
+  selectedEntities_.append(entity);
+  selectedIds_.insert(entity.id());
+}
+
+void SkiaCanvasWidget::deselect(Entity entity) {
+  selectedEntities_.removeOne(entity);
+  selectedIds_.remove(entity.id());
+}
+
+void SkiaCanvasWidget::clearSelection() {
+  selectedEntities_.clear();
+  selectedIds_.clear();
+}
+
 void SkiaCanvasWidget::resetSceneAndDeserialize(const QJsonObject &json) {
   scene_->clear();
   if (!json.isEmpty())
     scene_->deserialize(json);
+  invalidateAll();
+}
+
+void SkiaCanvasWidget::setPlaying(bool playing) {
+  m_isPlaying = playing;
+  schedulePrefetch();
 }
 
 void SkiaCanvasWidget::setVideoRendering(bool isRendering) {
   m_isRenderingVideo = isRendering;
+  invalidateAll();
 }
 
-QImage SkiaCanvasWidget::renderHighResFrame(int width, int height, float time) {
+QImage SkiaCanvasWidget::renderHighResFrame(int width, int height, float time,
+                                            int threads) {
+  FrameProfiler::Suspend suspend(scene_->profiler());
   auto imageInfo = SkImageInfo::Make(width, height, kRGBA_8888_SkColorType,
                                      kPremul_SkAlphaType);
-  sk_sp<SkSurface> surface = SkSurfaces::Raster(imageInfo);
-  if (!surface) {
-    qWarning() << "Failed to create offscreen SkSurface for rendering.";
-    return QImage();
-  }
-  SkCanvas *canvas = surface->getCanvas();
-
-  // Prepare canvas (clear, scale)
-  canvas->clear(SK_ColorWHITE);
-
-  // Calculate scale factor to fit and preserve aspect ratio
-  float canvasWidth = this->width();
-  float canvasHeight = this->height();
-  float scale =
-      std::min((float)width / canvasWidth, (float)height / canvasHeight);
-
-  // Calculate offsets to center the scaled content
-  float scaledWidth = canvasWidth * scale;
-  float scaledHeight = canvasHeight * scale;
-  float offsetX = (width - scaledWidth) / 2.0f;
-  float offsetY = (height - scaledHeight) / 2.0f;
-
-  // Apply transformations
-  canvas->translate(offsetX, offsetY);
-  canvas->scale(scale, scale);
-
-  // Draw the scene
-  scene_->draw(canvas, time);
-
-  // Get pixels back
   QImage image(width, height, QImage::Format_RGBA8888);
   SkPixmap pixmap(imageInfo, image.bits(), image.bytesPerLine());
 
-  if (!surface->readPixels(pixmap, 0, 0)) {
-    qWarning() << "Failed to read pixels from offscreen SkSurface.";
-    return QImage();
+  if (threads == 1) {
+    // Render straight into the image's pixels
+    sk_sp<SkSurface> surface = SkSurfaces::WrapPixels(pixmap);
+    if (!surface) {
+      qWarning() << "Failed to create offscreen SkSurface for rendering.";
+      return QImage();
+    }
+    SkCanvas *canvas = surface->getCanvas();
+    canvas->clear(SK_ColorWHITE);
+    canvas->concat(exportMatrix(width, height));
+    scene_->draw(canvas, time);
+    return image;
   }
 
+  // Record the scene once, then replay it into tiles of the image in parallel
+  SkPictureRecorder recorder;
+  SkRTreeFactory bbhFactory;
+  SkCanvas *canvas = recorder.beginRecording(
+      SkRect::MakeIWH(width, height), &bbhFactory);
+  canvas->concat(exportMatrix(width, height));
+  scene_->draw(canvas, time);
+  FrameExporter::rasterizeTiled(*recorder.finishRecordingAsPicture(), pixmap,
+                                SK_ColorWHITE, threads);
   return image;
 }
 
+SkMatrix SkiaCanvasWidget::exportMatrix(int width, int height) const {
+  // Fit the widget-sized view into the output, preserving aspect ratio.
+  return FrameExporter::fitTransform(this->width(), this->height(), width,
+                                     height);
+}
+
 void SkiaCanvasWidget::resetView() {
   m_viewMatrix.setIdentity();
   update();
@@ -127,7 +205,9 @@ void SkiaCanvasWidget::initializeGL() {
     qFatal("Skia: couldn’t create GrDirectContext");
 
   SkGraphics::Init();
-  // fontMgr = SkFontMgr::RefDefault();
+  fontMgr = SkFontMgr_New_FontConfig(nullptr);
+  if (fontMgr)
+    m_hudFont = SkFont(fontMgr->legacyMakeTypeface(nullptr, SkFontStyle()), 10);
 }
 
 void SkiaCanvasWidget::resizeGL(int w, int h) {
@@ -142,26 +222,333 @@ void SkiaCanvasWidget::resizeGL(int w, int h) {
       kRGBA_8888_SkColorType, nullptr, &props);
   if (!fSurface)
     qWarning("Skia: failed to wrap backend FBO");
+  invalidateAll();
 }
 
 void SkiaCanvasWidget::paintGL() {
   if (m_isSceneBeingReset || !fSurface)
     return;
+  TraceSpan span("frame", "paintGL");
+
+  const bool timeChanged = currentTime_ != m_lastPaintTime;
+  const bool interactive = timeChanged || isDragging_ || isRotating_ ||
+                           isMarqueeSelecting_ || m_isPanning;
+  QElapsedTimer frameTimer;
+  frameTimer.start();
+
+  // A proxy frame is upscaled as a whole, so partial repaints do not apply.
+  sk_sp<SkSurface> proxy = m_proxyLevel > 0 ? proxySurface() : nullptr;
+  if (proxy)
+    invalidateAll();
+
+  // Everything outside the damaged area is still valid from the last frame.
+  const SkIRect damage = takeDamage();
+  if (damage.isEmpty())
+    return;
 
+  const SkColor background = SkColorSetARGB(255, 22, 22, 22);
   SkCanvas *c = fSurface->getCanvas();
-  c->clear(SkColorSetARGB(255, 22, 22, 22));
-  c->setMatrix(m_viewMatrix);
+  c->save();
+  c->clipIRect(damage);
+  c->clear(background);
 
   // Render scene ------------------------------------------------------
-  scene_->draw(c, currentTime_);
+  if (proxy) {
+    const float scale = kProxyLevels[m_proxyLevel].scale;
+    SkCanvas *pc = proxy->getCanvas();
+    pc->clear(background);
+    pc->setMatrix(
+        SkMatrix::Concat(SkMatrix::Scale(scale, scale), m_viewMatrix));
+    drawScene(pc, timeChanged, kProxyLevels[m_proxyLevel].draft);
+    c->drawImageRect(proxy->makeImageSnapshot(),
+                     SkRect::MakeIWH(fSurface->width(), fSurface->height()),
+                     SkSamplingOptions(SkFilterMode::kLinear), nullptr);
+  } else {
+    c->setMatrix(m_viewMatrix);
+    drawScene(c, timeChanged, false);
+  }
 
   // Selection overlays -----------------------------------------------
+  // Drawn at full resolution on top of a proxy frame so handles stay crisp.
+  c->setMatrix(m_viewMatrix);
   if (!m_isRenderingVideo) {
     drawSelection(c);
     drawMarquee(c);
+    if (m_showProfilerOverlay)
+      drawProfilerOverlay(c);
+  }
+
+  c->restore();
+  FrameProfiler &profiler = scene_->profiler();
+  {
+    FrameProfiler::Scope scope(profiler, FramePhase::Flush);
+    fContext->flushAndSubmit();
+  }
+  const double frameMs = frameTimer.nsecsElapsed() / 1e6;
+  const RenderSystem::Stats &stats = scene_->getRenderer().stats();
+  profiler.endFrame(frameMs,
+                    {stats.frameEntitiesDrawn, stats.frameEntitiesReplayed,
+                     stats.frameEntitiesCulled, scene_->revision(),
+                     currentTime_});
+  m_flightRecorder.frameEnded(frameMs);
+  scene_->frameArena().reset();
+  if (interactive)
+    adaptProxyLevel(frameMs);
+
+  schedulePrefetch();
+}
+
+void SkiaCanvasWidget::drawScene(SkCanvas *canvas, bool timeChanged,
+                                 bool draft) {
+  // Scrubbing and playback replay whole cached frames. Edits at a fixed time
+  // keep drawing directly, where the picture cache and culling apply.
+  if (sk_sp<SkPicture> frame = cachedFrame(timeChanged)) {
+    canvas->drawPicture(frame);
+    return;
+  }
+  RenderSystem &renderer = scene_->getRenderer();
+  renderer.setDraftQuality(draft);
+  scene_->draw(canvas, currentTime_);
+  renderer.setDraftQuality(false);
+}
+
+// -------------------------------------------------------------------------
+//  Proxy resolution
+// -------------------------------------------------------------------------
+sk_sp<SkSurface> SkiaCanvasWidget::proxySurface() {
+  const float scale = kProxyLevels[m_proxyLevel].scale;
+  const int w = std::max(1, static_cast<int>(fSurface->width() * scale));
+  const int h = std::max(1, static_cast<int>(fSurface->height() * scale));
+  if (!m_proxySurface || m_proxySurface->width() != w ||
+      m_proxySurface->height() != h) {
+    m_proxySurface = SkSurfaces::RenderTarget(
+        fContext.get(), skgpu::Budgeted::kYes,
+        SkImageInfo::MakeN32Premul(w, h));
+    if (!m_proxySurface)
+      qWarning("Skia: failed to create proxy surface");
+  }
+  return m_proxySurface;
+}
+
+void SkiaCanvasWidget::adaptProxyLevel(double frameMs) {
+  // Step down one level per slow frame; quality only comes back once
+  // interaction pauses, which avoids flickering between levels.
+  if (frameMs > m_frameBudgetMs && m_proxyLevel < kMaxProxyLevel)
+    setProxyLevel(m_proxyLevel + 1);
+  if (m_proxyLevel > 0)
+    m_proxyIdleTimer.start(kProxyIdleMs);
+}
+
+void SkiaCanvasWidget::setProxyLevel(int level) {
+  level = std::clamp(level, 0, kMaxProxyLevel);
+  if (level == m_proxyLevel)
+    return;
+  m_proxyLevel = level;
+  if (level == 0)
+    m_proxySurface.reset();
+  invalidateAll();
+  emit proxyLevelChanged(level, kProxyLevels[level].scale,
+                         kProxyLevels[level].draft);
+}
+
+// -------------------------------------------------------------------------
+//  Frame cache
+// -------------------------------------------------------------------------
+bool SkiaCanvasWidget::frameCacheUsable() {
+  // Lua draw callbacks and C++ scripts depend on script state, not just on
+  // the timeline time, so their frames cannot be reused.
+  return !m_isRenderingVideo && !m_isSceneBeingReset &&
+         scene_->getRenderer().stats().frameScriptedEntities == 0 &&
+         scene_->ecs().count<CppScriptComponent>() == 0;
+}
+
+sk_sp<SkPicture> SkiaCanvasWidget::cachedFrame(bool recordOnMiss) {
+  if (!frameCacheUsable())
+    return nullptr;
+  const int64_t tick = m_frameCache.tickOf(currentTime_);
+  if (sk_sp<SkPicture> hit = m_frameCache.find(tick, scene_->revision()))
+    return hit;
+  return recordOnMiss ? recordFrame(tick) : nullptr;
+}
+
+sk_sp<SkPicture> SkiaCanvasWidget::recordFrame(int64_t tick) {
+  const uint64_t revision = scene_->revision();
+  SkPictureRecorder recorder;
+  SkRTreeFactory bbhFactory;
+  SkCanvas *canvas = recorder.beginRecording(kFrameBounds, &bbhFactory);
+  // The frame may be replayed at any zoom, so it keeps full detail. Offscreen
+  // keeps that from evicting the view's own recordings and stats.
+  RenderSystem &renderer = scene_->getRenderer();
+  renderer.setOffscreen(true);
+  renderer.setLevelOfDetail(false);
+  scene_->draw(canvas, m_frameCache.timeOf(tick));
+  renderer.setLevelOfDetail(true);
+  const bool scripted = renderer.stats().frameScriptedEntities > 0;
+  renderer.setOffscreen(false);
+  sk_sp<SkPicture> frame = recorder.finishRecordingAsPicture();
+
+  // Still fine to show, but not to keep if a scripted entity appeared at this
+  // time or the scene changed while drawing.
+  if (!scripted && frameCacheUsable() && scene_->revision() == revision)
+    m_frameCache.insert(tick, revision, frame);
+  return frame;
+}
+
+void SkiaCanvasWidget::schedulePrefetch() {
+  // Every paint pushes the start back, so dragging, panning and scrubbing
+  // never share the event loop with recording.
+  if (frameCacheUsable() && !m_isPlaying)
+    m_prefetchTimer.start(kPrefetchIdleMs);
+  else
+    m_prefetchTimer.stop();
+}
+
+void SkiaCanvasWidget::prefetchFrames() {
+  if (!frameCacheUsable() || !isVisible() || m_isPlaying)
+    return;
+  // A button held without moving does not paint; wait for the release.
+  if (isDragging_ || isRotating_ || isMarqueeSelecting_ || m_isPanning) {
+    m_prefetchTimer.start(kPrefetchIdleMs);
+    return;
+  }
+
+  const uint64_t revision = scene_->revision();
+  const int64_t center = m_frameCache.tickOf(currentTime_);
+  const int64_t last = m_frameCache.tickOf(m_timelineDuration);
+  if (center != m_prefetchCenter) {
+    m_prefetchCenter = center;
+    m_prefetchRecorded = 0;
   }
 
-  fContext->flushAndSubmit();
+  // Shrink the window to what the budget holds, judging by the frames so far.
+  int radius = kPrefetchRadius;
+  if (m_frameCache.size() > 0) {
+    const size_t perFrame = m_frameCache.bytesUsed() / m_frameCache.size() + 1;
+    radius = std::min<int64_t>(radius, m_frameCache.budget() / perFrame / 2);
+  }
+
+  // Mark the window most recently used, nearest frames last, so recording
+  // evicts frames far from the playhead first.
+  for (int d = radius; d >= 0; --d)
+    for (int64_t tick : {center + d, center - d})
+      m_frameCache.find(tick, revision);
+
+  QElapsedTimer slice;
+  slice.start();
+  // Nearest first, alternating ahead of and behind the playhead. The pass is
+  // capped so a window that does not fit the budget cannot thrash. A frame
+  // is only started if the last one would still fit the slice; at least one
+  // is recorded per slice, so frames slower than the slice still progress.
+  bool recorded = false;
+  for (int d = 1; d <= radius && m_prefetchRecorded < 2 * radius; ++d)
+    for (int64_t tick : {center + d, center - d}) {
+      if (tick < 0 || tick > last || m_frameCache.contains(tick, revision))
+        continue;
+      if (recorded && slice.elapsed() + m_prefetchFrameMs > kPrefetchSliceMs) {
+        m_prefetchTimer.start(0); // continue on the next idle tick
+        return;
+      }
+      QElapsedTimer frameTimer;
+      frameTimer.start();
+      {
+        FrameProfiler::Suspend suspend(scene_->profiler());
+        recordFrame(tick);
+      }
+      m_prefetchFrameMs = frameTimer.elapsed();
+      recorded = true;
+      ++m_prefetchRecorded;
+      if (!frameCacheUsable() || scene_->revision() != revision)
+        return;
+    }
+}
+
+// -------------------------------------------------------------------------
+//  Damage tracking
+// -------------------------------------------------------------------------
+void SkiaCanvasWidget::trackDamage() {
+  scene_->getSpatialIndex().setDamageListener([this](const SkRect &r) {
+    if (r.isFinite())
+      m_worldDamage.join(r);
+    else
+      invalidateAll();
+  });
+
+  // Changes the spatial index does not see: visibility windows, and scripts
+  // that may draw anywhere.
+  auto &ecs = scene_->ecs();
+  ecs.observer<const AnimationComponent>()
+      .event(flecs::OnSet)
+      .event(flecs::OnRemove)
+      .each([this](flecs::entity, const AnimationComponent &) {
+        invalidateAll();
+      });
+  ecs.observer<const ScriptComponent>()
+      .event(flecs::OnSet)
+      .event(flecs::OnRemove)
+      .each(
+          [this](flecs::entity, const ScriptComponent &) { invalidateAll(); });
+  ecs.observer<const CppScriptComponent>()
+      .event(flecs::OnSet)
+      .event(flecs::OnRemove)
+      .each([this](flecs::entity, const CppScriptComponent &) {
+        invalidateAll();
+      });
+}
+
+SkIRect SkiaCanvasWidget::takeDamage() {
+  const SkIRect frame = SkIRect::MakeWH(fSurface->width(), fSurface->height());
+  const SkIRect overlay =
+      m_isRenderingVideo ? SkIRect::MakeEmpty() : overlayBounds();
+
+  // Script draw callbacks run every frame and may change anything.
+  if (m_viewMatrix != m_lastViewMatrix || currentTime_ != m_lastPaintTime ||
+      scene_->getRenderer().stats().frameScriptedEntities > 0 ||
+      scene_->ecs().count<CppScriptComponent>() > 0)
+    m_fullRepaint = true;
+
+  SkIRect damage = frame;
+  if (!m_fullRepaint) {
+    damage = SkIRect::MakeEmpty();
+    if (!m_worldDamage.isEmpty())
+      damage = m_viewMatrix.mapRect(m_worldDamage).roundOut().makeOutset(2, 2);
+    // Overlays are redrawn where they were and where they are now.
+    damage.join(m_lastOverlayBounds);
+    damage.join(overlay);
+    if (!damage.intersect(frame))
+      damage.setEmpty();
+  }
+
+  m_worldDamage.setEmpty();
+  m_lastOverlayBounds = overlay;
+  m_lastViewMatrix = m_viewMatrix;
+  m_lastPaintTime = currentTime_;
+  m_fullRepaint = false;
+  return damage;
+}
+
+SkIRect SkiaCanvasWidget::overlayBounds() const {
+  // Mirrors drawSelection()/drawMarquee(); both draw under m_viewMatrix.
+  SkRect world = SkRect::MakeEmpty();
+  for (Entity e : selectedEntities_)
+    if (e.is_alive() && e.has<TransformComponent>()) {
+      SkRect bb = localBounds(e);
+      // Include the rotation handle above the box.
+      bb.fTop -= 10;
+      SkRect r = e.get<TransformComponent>().matrix().mapRect(bb);
+      world.join(r.makeOutset(10, 10));
+    }
+  if (isMarqueeSelecting_) {
+    SkRect r = SkRect::MakeLTRB(marqueeStartPoint_.x(), marqueeStartPoint_.y(),
+                                marqueeEndPoint_.x(), marqueeEndPoint_.y());
+    r.sort();
+    world.join(r.makeOutset(2, 2));
+  }
+  SkIRect device = SkIRect::MakeEmpty();
+  if (!world.isEmpty())
+    device = m_viewMatrix.mapRect(world).roundOut().makeOutset(2, 2);
+  if (m_showProfilerOverlay)
+    device.join(kHudRect.roundOut());
+  return device;
 }
 
 // -------------------------------------------------------------------------
@@ -210,23 +597,27 @@ void SkiaCanvasWidget::mousePressEvent(QMouseEvent *e) {
   SkPoint clickPos = mapScreenToView(e->pos());
 
   // Hit detection ------------------------------------------------------
-  ecs.each<TransformComponent>([&](flecs::entity ent, TransformComponent &tr) {
+  // The spatial index narrows the search to entities whose world bounds
+  // contain the click; the oriented box test decides. The entity drawn last,
+  // i.e. on top, wins.
+  scene_->getSpatialIndex().query(clickPos, spatialHits_);
+  int64_t clickedOrder = -1;
+  for (flecs::entity_t id : spatialHits_) {
+    flecs::entity ent(ecs, id);
+    const auto *version = ent.try_get<RenderVersionComponent>();
+    const int64_t order = version ? version->drawOrder : 0;
+    if (order < clickedOrder)
+      continue;
     if (ent.has<SceneBackgroundComponent>())
-      return;
-    if (ent.has<ShapeComponent>()) {
-      auto &sc = ent.get<ShapeComponent>();
-      SkRect originalBounds = sc.shape->getBoundingBox();
-      SkMatrix m;
-      m.setTranslate(tr.x, tr.y);
-      m.preRotate(tr.rotation * 180 / M_PI);
-      m.preScale(tr.sx, tr.sy);
-      SkPoint corners[4];
-      originalBounds.toQuad(corners);
-      m.mapPoints(corners, corners);
-      if (isPointInPolygon(clickPos, corners, 4))
-        clicked = ent;
+      continue;
+    SkPoint corners[4];
+    localBounds(ent).toQuad(corners);
+    ent.get<TransformComponent>().matrix().mapPoints(corners, corners);
+    if (isPointInPolygon(clickPos, corners, 4)) {
+      clicked = ent;
+      clickedOrder = order;
     }
-  });
+  }
 
   // Rotation‑handle check (only if one selection) ---------------------
   if (selectedEntities_.size() == 1) {
@@ -262,14 +653,14 @@ void SkiaCanvasWidget::mousePressEvent(QMouseEvent *e) {
   // Selection logic ----------------------------------------------------
   if (clicked != kInvalidEntity) {
     if (shiftPressed) {
-      if (selectedEntities_.contains(clicked))
-        selectedEntities_.removeOne(clicked);
+      if (isSelected(clicked))
+        deselect(clicked);
       else
-        selectedEntities_.append(clicked);
+        select(clicked);
     } else {
-      if (!selectedEntities_.contains(clicked)) {
-        selectedEntities_.clear();
-        selectedEntities_.append(clicked);
+      if (!isSelected(clicked)) {
+        clearSelection();
+        select(clicked);
       }
     }
     isDragging_ = true;
@@ -282,7 +673,7 @@ void SkiaCanvasWidget::mousePressEvent(QMouseEvent *e) {
       }
   } else {
     if (!shiftPressed)
-      selectedEntities_.clear();
+      clearSelection();
     isMarqueeSelecting_ = true;
     marqueeStartPoint_ = e->pos();
     marqueeEndPoint_ = e->pos();
@@ -316,6 +707,7 @@ void SkiaCanvasWidget::mouseMoveEvent(QMouseEvent *e) {
       else if (angleDelta < -M_PI)
         angleDelta += 2 * M_PI;
       tc.rotation += angleDelta;
+      ent.modified<TransformComponent>();
       dragStart_ = e->pos();
       emit transformChanged(ent);
       update();
@@ -336,6 +728,7 @@ void SkiaCanvasWidget::mouseMoveEvent(QMouseEvent *e) {
         auto &tc = ent.get_mut<TransformComponent>();
         tc.x = initialTransforms_[ent].x + skDelta.x();
         tc.y = initialTransforms_[ent].y + skDelta.y();
+        ent.modified<TransformComponent>();
       }
     if (selectedEntities_.size() == 1)
       emit transformChanged(selectedEntities_.first());
@@ -365,29 +758,21 @@ void SkiaCanvasWidget::mouseReleaseEvent(QMouseEvent *e) {
     selRect.sort();
 
     if (!shiftPressed)
-      selectedEntities_.clear();
-
-    ecs.each<TransformComponent>(
-        [&](flecs::entity ent, TransformComponent &tr) {
-          if (ent.has<SceneBackgroundComponent>())
-            return;
-          if (ent.has<ShapeComponent>()) {
-            auto &sc = ent.get<ShapeComponent>();
-            if (!sc.shape)
-              return; // Skip if shape is not valid
-
-            SkRect bb = sc.shape->getBoundingBox();
-            SkMatrix m;
-            m.setTranslate(tr.x, tr.y);
-            m.preRotate(tr.rotation * 180 / M_PI);
-            m.preScale(tr.sx, tr.sy);
-            SkRect aabb;
-            m.mapRect(&aabb, bb);
-            if (SkRect::Intersects(selRect, aabb))
-              if (!selectedEntities_.contains(ent))
-                selectedEntities_.append(ent);
-          }
-        });
+      clearSelection();
+
+    // Indexed bounds include stroke outsets, so re-test the shape bounds.
+    // Sorting keeps the selection in creation order like a full scan did.
+    scene_->getSpatialIndex().query(selRect, spatialHits_);
+    std::sort(spatialHits_.begin(), spatialHits_.end());
+    for (flecs::entity_t id : spatialHits_) {
+      flecs::entity ent(ecs, id);
+      if (ent.has<SceneBackgroundComponent>())
+        continue;
+      SkRect aabb =
+          ent.get<TransformComponent>().matrix().mapRect(localBounds(ent));
+      if (SkRect::Intersects(selRect, aabb) && !isSelected(ent))
+        select(ent);
+    }
     emit canvasSelectionChanged(selectedEntities_);
   }
 
@@ -427,12 +812,7 @@ void SkiaCanvasWidget::drawSelection(SkCanvas *c) {
   for (Entity e : selectedEntities_)
     if (e.is_alive() && e.has<TransformComponent>()) {
       auto tc = e.get<TransformComponent>();
-      SkRect bb;
-      if (e.has<ShapeComponent>()) {
-        auto &sc = e.get<ShapeComponent>();
-        if (sc.shape)
-          bb = sc.shape->getBoundingBox();
-      }
+      SkRect bb = localBounds(e);
       SkMatrix m;
       m.setTranslate(tc.x, tc.y);
       m.preRotate(tc.rotation * 180.f / M_PI);
@@ -471,6 +851,101 @@ void SkiaCanvasWidget::drawMarquee(SkCanvas *c) {
   c->drawRect(r, border);
 }
 
+void SkiaCanvasWidget::setProfilerOverlayVisible(bool visible) {
+  m_showProfilerOverlay = visible;
+  invalidateAll();
+  update();
+}
+
+void SkiaCanvasWidget::measureMemory(MemoryReport::Section &section) {
+  section.add("frame cache", m_frameCache.size(), m_frameCache.bytesUsed());
+  if (fContext) {
+    int resources = 0;
+    size_t bytes = 0;
+    fContext->getResourceCacheUsage(&resources, &bytes);
+    section.add("GPU resource cache", resources, bytes);
+  }
+}
+
+void SkiaCanvasWidget::drawProfilerOverlay(SkCanvas *c) {
+  const std::vector<FrameSample> frames =
+      scene_->profiler().samples().recent(kHudFrames);
+
+  c->save();
+  c->resetMatrix();
+  SkPaint panel;
+  panel.setColor(SkColorSetARGB(200, 12, 12, 12));
+  c->drawRect(kHudRect, panel);
+
+  SkPaint text;
+  text.setAntiAlias(true);
+  text.setColor(SK_ColorWHITE);
+  const float left = kHudRect.left() + 6;
+  char line[96];
+  if (!frames.empty()) {
+    const FrameSample &last = frames.back();
+    std::snprintf(line, sizeof(line),
+                  "%.2f ms   drawn %u  replayed %u  culled %u", last.totalMs,
+                  last.entitiesDrawn, last.entitiesReplayed,
+                  last.entitiesCulled);
+    c->drawString(line, left, kHudRect.top() + 14, m_hudFont, text);
+  }
+  // With allocation tracking on, a second header line squeezes the graph.
+  float top = kHudRect.top();
+  if (AllocTracker::enabled()) {
+    top += 12;
+    const FrameSample last = frames.empty() ? FrameSample() : frames.back();
+    std::snprintf(line, sizeof(line), "%u allocs  %.1f KiB  (%u in Lua)",
+                  last.allocs, last.allocBytes / 1024.0, last.luaAllocs);
+    c->drawString(line, left, top + 14, m_hudFont, text);
+  }
+
+  // Legend: phase colour, name and the newest frame's time.
+  for (int i = 0; i < kFramePhaseCount; ++i) {
+    const float x = left + (i % 3) * 100.f;
+    const float y = top + 28 + (i / 3) * 12.f;
+    SkPaint swatch;
+    swatch.setColor(kPhaseColors[i]);
+    c->drawRect(SkRect::MakeXYWH(x, y - 7, 7, 7), swatch);
+    std::snprintf(line, sizeof(line), "%s %.2f",
+                  framePhaseName(static_cast<FramePhase>(i)),
+                  frames.empty() ? 0.f : frames.back().phaseMs[i]);
+    c->drawString(line, x + 10, y, m_hudFont, text);
+  }
+
+  // Stacked phase bars, newest on the right. Time not covered by a phase
+  // (overlays, proxy upscaling, Qt) is drawn in dark grey on top.
+  const SkRect graph =
+      SkRect::MakeLTRB(left, top + 48, kHudRect.right() - 6,
+                       kHudRect.bottom() - 6);
+  const float pxPerMs = graph.height() / (2 * m_frameBudgetMs);
+  const float barWidth = graph.width() / kHudFrames;
+  SkPaint bar;
+  for (size_t f = 0; f < frames.size(); ++f) {
+    const FrameSample &frame = frames[f];
+    const float x = graph.right() - (frames.size() - f) * barWidth;
+    float y = graph.bottom(), covered = 0.f;
+    auto stack = [&](float ms, SkColor color) {
+      const float top = std::max(graph.top(), y - ms * pxPerMs);
+      bar.setColor(color);
+      c->drawRect(SkRect::MakeLTRB(x, top, x + barWidth, y), bar);
+      y = top;
+    };
+    for (int i = 0; i < kFramePhaseCount; ++i) {
+      stack(frame.phaseMs[i], kPhaseColors[i]);
+      covered += frame.phaseMs[i];
+    }
+    stack(std::max(0.f, frame.totalMs - covered), SkColorSetRGB(60, 60, 60));
+  }
+
+  SkPaint budget;
+  budget.setColor(SkColorSetARGB(180, 255, 255, 255));
+  budget.setStyle(SkPaint::kStroke_Style);
+  const float budgetY = graph.bottom() - m_frameBudgetMs * pxPerMs;
+  c->drawLine(graph.left(), budgetY, graph.right(), budgetY, budget);
+  c->restore();
+}
+
 SkPoint SkiaCanvasWidget::mapScreenToView(const QPointF &point) const {
   SkMatrix inverseView;
   if (!m_viewMatrix.invert(&inverseView)) {
@@ -3,6 +3,8 @@
 #include "serialization.h"
 #include "window.h"
 
+#include <QJsonDocument>
+
 // =========================================================================
 // HELPERS
 // =========================================================================
@@ -27,6 +29,12 @@ static inline QJsonObject snapshotEntity(Scene &scene, Entity e) {
   return serializeEntity(scene, e);
 }
 
+size_t jsonBytes(const QJsonObject &o) {
+  if (o.isEmpty())
+    return 0;
+  return QJsonDocument(o).toJson(QJsonDocument::Compact).size();
+}
+
 void applyJsonToEntity(flecs::world &world, flecs::entity e,
                        const QJsonObject &o, bool is_paste) {
   // Name Component
@@ -116,6 +124,13 @@ void applyJsonToEntity(flecs::world &world, flecs::entity e,
       shp->deserialize(j["properties"].toObject());
     e.set<ShapeComponent>({std::move(shp)});
   }
+  if (o.contains("InstancedShapeComponent")) {
+    const QJsonObject j = o["InstancedShapeComponent"].toObject();
+    auto shp = ShapeFactory::create(j["kind"].toString().toStdString());
+    if (shp && j.contains("properties"))
+      shp->deserialize(j["properties"].toObject());
+    e.set<InstancedShapeComponent>({std::move(shp)});
+  }
 }
 
 static inline Entity createFrom(Scene &scene, const QJsonObject &json,
@@ -322,6 +337,7 @@ void MoveEntityCommand::undo() {
     t.x = m_oldX;
     t.y = m_oldY;
     t.rotation = m_oldRot;
+    m_entity.modified<TransformComponent>();
     m_mainWindow->canvas()->update();
   }
 }
@@ -332,6 +348,7 @@ void MoveEntityCommand::redo() {
     t.x = m_newX;
     t.y = m_newY;
     t.rotation = m_newRot;
+    m_entity.modified<TransformComponent>();
     m_mainWindow->canvas()->update();
   }
 }
@@ -389,6 +406,7 @@ void ChangeTransformCommand::undo() {
     t.rotation = m_oldRot;
     t.sx = m_oldSx;
     t.sy = m_oldSy;
+    m_entity.modified<TransformComponent>();
     m_mainWindow->canvas()->update();
   }
 }
@@ -400,6 +418,7 @@ void ChangeTransformCommand::redo() {
     t.rotation = m_newRot;
     t.sx = m_newSx;
     t.sy = m_newSy;
+    m_entity.modified<TransformComponent>();
     m_mainWindow->canvas()->update();
   }
 }
@@ -442,6 +461,7 @@ void ChangeMaterialCommand::undo() {
     m.isStroked = m_oldStroke;
     m.strokeWidth = m_oldWidth;
     m.antiAliased = m_oldAA;
+    m_entity.modified<MaterialComponent>();
     m_mainWindow->canvas()->update();
   }
 }
@@ -453,6 +473,7 @@ void ChangeMaterialCommand::redo() {
     m.isStroked = m_newStroke;
     m.strokeWidth = m_newWidth;
     m.antiAliased = m_newAA;
+    m_entity.modified<MaterialComponent>();
     m_mainWindow->canvas()->update();
   }
 }
@@ -476,6 +497,7 @@ void ChangeAnimationCommand::undo() {
     auto &a = m_entity.get_mut<AnimationComponent>();
     a.entryTime = m_oldEntry;
     a.exitTime = m_oldExit;
+    m_entity.modified<AnimationComponent>();
     m_mainWindow->canvas()->update();
   }
 }
@@ -484,6 +506,7 @@ void ChangeAnimationCommand::redo() {
     auto &a = m_entity.get_mut<AnimationComponent>();
     a.entryTime = m_newEntry;
     a.exitTime = m_newExit;
+    m_entity.modified<AnimationComponent>();
     m_mainWindow->canvas()->update();
   }
 }
@@ -545,6 +568,7 @@ void ChangeShapePropertyCommand::undo() {
     auto &sc = m_entity.get_mut<ShapeComponent>();
     if (sc.shape) {
       sc.shape->deserialize(m_oldProps);
+      m_entity.modified<ShapeComponent>();
       m_mainWindow->canvas()->update();
     }
   }
@@ -554,6 +578,7 @@ void ChangeShapePropertyCommand::redo() {
     auto &sc = m_entity.get_mut<ShapeComponent>();
     if (sc.shape) {
       sc.shape->deserialize(m_newProps);
+      m_entity.modified<ShapeComponent>();
       m_mainWindow->canvas()->update();
     }
   }
@@ -0,0 +1,500 @@
+#include "exporter.h"
+#include "trace.h"
+
+#include "include/core/SkPicture.h"
+#include "include/core/SkPictureRecorder.h"
+#include "include/core/SkStream.h"
+#include "include/core/SkSurface.h"
+#include "include/encode/SkPngEncoder.h"
+#include "include/encode/SkWebpEncoder.h"
+
+#include <QDir>
+#include <QThread>
+#include <QThreadPool>
+#include <QtConcurrent/QtConcurrent>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <thread>
+
+namespace {
+using Clock = std::chrono::steady_clock;
+
+double secondsSince(Clock::time_point start) {
+  return std::chrono::duration<double>(Clock::now() - start).count();
+}
+
+// One reusable frame buffer. Skia renders straight into `pixels` through
+// `surface`, and the writer passes the same memory to the sink.
+struct Slot {
+  enum class State { Free, Rendering, Ready };
+  std::unique_ptr<uint8_t[]> pixels;
+  sk_sp<SkSurface> surface;
+  State state = State::Free;
+  int frame = -1;
+};
+} // namespace
+
+QString FrameExporter::Result::summary() const {
+  return QString("%1 frames in %2 s (%3 fps) on %4 threads, %5x parallel "
+                 "raster, %6 s recording, %7 s writing, %8 buffers")
+      .arg(framesWritten)
+      .arg(wallSeconds, 0, 'f', 2)
+      .arg(fps(), 0, 'f', 1)
+      .arg(threads)
+      .arg(parallelism(), 0, 'f', 2)
+      .arg(recordSeconds, 0, 'f', 2)
+      .arg(writeSeconds, 0, 'f', 2)
+      .arg(ringSize);
+}
+
+QJsonObject FrameExporter::Result::toJson() const {
+  QJsonObject o;
+  o["frames"] = framesWritten;
+  o["threads"] = threads;
+  o["ringSize"] = ringSize;
+  o["cancelled"] = cancelled;
+  o["error"] = error;
+  o["wallSeconds"] = wallSeconds;
+  o["recordSeconds"] = recordSeconds;
+  o["rasterSeconds"] = rasterSeconds;
+  o["writeSeconds"] = writeSeconds;
+  o["fps"] = fps();
+  o["parallelism"] = parallelism();
+  return o;
+}
+
+// ------- FfmpegSink -------
+
+FfmpegSink::FfmpegSink(const QString &videoPath, const QString &ffmpegPath)
+    : videoPath_(videoPath), ffmpegPath_(ffmpegPath) {}
+
+FfmpegSink::~FfmpegSink() = default;
+
+bool FfmpegSink::open(const SkImageInfo &info, int fps) {
+  QStringList args;
+  args << "-y"
+       << "-hide_banner"
+       << "-loglevel"
+       << "error"
+       << "-f"
+       << "rawvideo"
+       << "-pix_fmt"
+       << "rgba"
+       << "-s" << QString("%1x%2").arg(info.width()).arg(info.height())
+       << "-r" << QString::number(fps) << "-i"
+       << "-" // Input from stdin
+       << "-vf"
+       << "crop=trunc(iw/2)*2:trunc(ih/2)*2"
+       << "-c:v"
+       << "libx264"
+       << "-pix_fmt"
+       << "yuv420p" << videoPath_;
+
+  process_ = std::make_unique<QProcess>();
+  process_->start(ffmpegPath_, args);
+  if (!process_->waitForStarted()) {
+    error_ = "Could not start ffmpeg. Is it installed and in your PATH?";
+    process_.reset();
+    return false;
+  }
+  return true;
+}
+
+bool FfmpegSink::write(int frame, const SkPixmap &pixels) {
+  const char *data = static_cast<const char *>(pixels.addr());
+  const qint64 size = pixels.computeByteSize();
+  if (process_->write(data, size) != size) {
+    error_ = "Writing to ffmpeg failed: " + process_->errorString();
+    return false;
+  }
+  // Block until the pipe has taken the frame, so QProcess does not buffer
+  // without bound and a slow encoder throttles rendering through the ring.
+  TraceSpan span("export", "ffmpeg pipe", "frame", frame);
+  while (process_->bytesToWrite() > 0)
+    if (!process_->waitForBytesWritten(-1)) {
+      error_ = "Writing to ffmpeg failed: " + process_->errorString();
+      return false;
+    }
+  return true;
+}
+
+bool FfmpegSink::close() {
+  if (!process_)
+    return false;
+  process_->closeWriteChannel();
+  bool ok = true;
+  if (!process_->waitForFinished(30000)) { // 30s timeout
+    process_->kill();
+    process_->waitForFinished();
+    error_ = "ffmpeg timed out or failed to finish.";
+    ok = false;
+  } else if (process_->exitStatus() != QProcess::NormalExit ||
+             process_->exitCode() != 0) {
+    error_ = "ffmpeg failed: " +
+             QString::fromLocal8Bit(process_->readAllStandardError());
+    ok = false;
+  }
+  process_.reset();
+  return ok;
+}
+
+// ------- ImageSequenceSink -------
+
+namespace {
+bool encodeFrame(const QString &path, const SkPixmap &pixels,
+                 ImageSequenceSink::Format format) {
+  SkFILEWStream stream(path.toLocal8Bit().constData());
+  if (!stream.isValid())
+    return false;
+  switch (format) {
+  case ImageSequenceSink::Format::Png:
+    return SkPngEncoder::Encode(&stream, pixels, {});
+  case ImageSequenceSink::Format::WebP: {
+    SkWebpEncoder::Options options;
+    options.fCompression = SkWebpEncoder::Compression::kLossless;
+    return SkWebpEncoder::Encode(&stream, pixels, options);
+  }
+  case ImageSequenceSink::Format::Raw:
+    return stream.write(pixels.addr(), pixels.computeByteSize());
+  }
+  return false;
+}
+} // namespace
+
+ImageSequenceSink::ImageSequenceSink(const QString &directory, Format format,
+                                     int encoderThreads, int maxInFlight)
+    : directory_(directory), format_(format), encoderThreads_(encoderThreads),
+      maxInFlight_(maxInFlight) {}
+
+ImageSequenceSink::~ImageSequenceSink() { pool_.waitForDone(); }
+
+QString ImageSequenceSink::extension(Format format) {
+  switch (format) {
+  case Format::Png:
+    return "png";
+  case Format::WebP:
+    return "webp";
+  case Format::Raw:
+    return "rgba";
+  }
+  return {};
+}
+
+bool ImageSequenceSink::parseFormat(const QString &name, Format &format) {
+  const QString lower = name.toLower();
+  if (lower == "png")
+    format = Format::Png;
+  else if (lower == "webp")
+    format = Format::WebP;
+  else if (lower == "raw" || lower == "rgba")
+    format = Format::Raw;
+  else
+    return false;
+  return true;
+}
+
+QString ImageSequenceSink::framePath(int frame) const {
+  return QDir(directory_).filePath(QString("%1%2.%3")
+                                       .arg(prefix_)
+                                       .arg(frame, 5, 10, QChar('0'))
+                                       .arg(extension(format_)));
+}
+
+bool ImageSequenceSink::open(const SkImageInfo &, int) {
+  if (!QDir().mkpath(directory_)) {
+    error_ = QString("Could not create directory %1").arg(directory_);
+    return false;
+  }
+  if (encoderThreads_ <= 0)
+    encoderThreads_ = std::max(1, QThread::idealThreadCount());
+  if (maxInFlight_ <= 0)
+    maxInFlight_ = encoderThreads_ + 2;
+  pool_.setMaxThreadCount(encoderThreads_);
+  return true;
+}
+
+bool ImageSequenceSink::write(int frame, const SkPixmap &pixels) {
+  // Take a free copy buffer, allocating up to maxInFlight_ of them lazily.
+  std::unique_ptr<uint8_t[]> buffer;
+  {
+    std::unique_lock<std::mutex> lock(mutex_);
+    bufferFreed_.wait(lock, [&] {
+      return !encodeError_.isEmpty() || !freeBuffers_.empty() ||
+             buffersAllocated_ < maxInFlight_;
+    });
+    if (!encodeError_.isEmpty()) {
+      error_ = encodeError_;
+      return false;
+    }
+    if (!freeBuffers_.empty()) {
+      buffer = std::move(freeBuffers_.back());
+      freeBuffers_.pop_back();
+    } else {
+      ++buffersAllocated_;
+    }
+  }
+
+  const SkImageInfo &info = pixels.info();
+  const size_t rowBytes = info.minRowBytes();
+  if (!buffer)
+    buffer.reset(new uint8_t[info.computeByteSize(rowBytes)]);
+  const SkPixmap copy(info, buffer.get(), rowBytes);
+  pixels.readPixels(copy);
+
+  // The job owns the buffer until it puts it back on the free list.
+  uint8_t *owned = buffer.release();
+  QtConcurrent::run(&pool_, [this, frame, copy, owned] {
+    TraceSpan span("export", "encode image", "frame", frame);
+    const QString path = framePath(frame);
+    const bool ok = encodeFrame(path, copy, format_);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!ok && encodeError_.isEmpty())
+      encodeError_ = QString("Could not write %1").arg(path);
+    freeBuffers_.emplace_back(owned);
+    bufferFreed_.notify_all();
+  });
+  return true;
+}
+
+bool ImageSequenceSink::close() {
+  pool_.waitForDone();
+  std::lock_guard<std::mutex> lock(mutex_);
+  freeBuffers_.clear();
+  buffersAllocated_ = 0;
+  if (!encodeError_.isEmpty()) {
+    error_ = encodeError_;
+    return false;
+  }
+  return true;
+}
+
+// ------- FrameExporter -------
+
+FrameExporter::FrameExporter(Scene &scene, const Settings &settings)
+    : scene_(scene), settings_(settings) {}
+
+SkMatrix FrameExporter::fitTransform(float srcWidth, float srcHeight,
+                                     int width, int height) {
+  const float scale = std::min(width / srcWidth, height / srcHeight);
+  SkMatrix m;
+  m.setTranslate((width - srcWidth * scale) / 2.0f,
+                 (height - srcHeight * scale) / 2.0f);
+  m.preScale(scale, scale);
+  return m;
+}
+
+void FrameExporter::rasterizeTiled(const SkPicture &picture,
+                                   const SkPixmap &dst, SkColor clearColor,
+                                   int threads, int tileSize) {
+  std::vector<SkIRect> tiles;
+  for (int y = 0; y < dst.height(); y += tileSize)
+    for (int x = 0; x < dst.width(); x += tileSize)
+      tiles.push_back(
+          SkIRect::MakeXYWH(x, y, std::min(tileSize, dst.width() - x),
+                            std::min(tileSize, dst.height() - y)));
+
+  // Tiles are taken from a shared counter so threads that draw cheap, empty
+  // areas move on to the busy ones.
+  std::atomic<size_t> next{0};
+  auto work = [&] {
+    for (size_t i = next++; i < tiles.size(); i = next++) {
+      const SkIRect &tile = tiles[i];
+      SkPixmap pixels;
+      if (!dst.extractSubset(&pixels, tile))
+        continue;
+      sk_sp<SkSurface> surface = SkSurfaces::WrapPixels(pixels);
+      if (!surface)
+        continue;
+      SkCanvas *canvas = surface->getCanvas();
+      TraceSpan span("raster", "tile", "tile", static_cast<int64_t>(i));
+      canvas->clear(clearColor);
+      canvas->translate(-tile.x(), -tile.y());
+      canvas->drawPicture(&picture);
+    }
+  };
+
+  if (threads <= 0)
+    threads = std::max(1, QThread::idealThreadCount());
+  threads = std::min<int>(threads, tiles.size());
+  std::vector<std::thread> helpers;
+  for (int i = 1; i < threads; ++i)
+    helpers.emplace_back(work);
+  work();
+  for (std::thread &t : helpers)
+    t.join();
+}
+
+FrameExporter::Result FrameExporter::run(FrameSink &sink,
+                                         const ProgressCallback &progress) {
+  Result result;
+  const int threads = settings_.threads > 0
+                          ? settings_.threads
+                          : std::max(1, QThread::idealThreadCount());
+  const int ringSize =
+      settings_.ringSize > 0 ? settings_.ringSize : threads + 2;
+  result.threads = threads;
+  result.ringSize = ringSize;
+
+  const SkImageInfo info =
+      SkImageInfo::Make(settings_.width, settings_.height,
+                        kRGBA_8888_SkColorType, kPremul_SkAlphaType);
+  const size_t rowBytes = info.minRowBytes();
+  const SkRect bounds = SkRect::MakeIWH(settings_.width, settings_.height);
+  const float dt = 1.0f / settings_.fps;
+
+  // Frame i always lives in ring[i % ringSize]. Buffers and the surfaces
+  // wrapping them are allocated once for the whole export.
+  std::vector<Slot> ring(ringSize);
+  for (Slot &slot : ring) {
+    slot.pixels.reset(new uint8_t[info.computeByteSize(rowBytes)]);
+    slot.surface =
+        SkSurfaces::WrapPixels(info, slot.pixels.get(), rowBytes, nullptr);
+    if (!slot.surface) {
+      result.error = "Could not allocate frame buffers for export.";
+      return result;
+    }
+  }
+
+  std::mutex mutex;
+  std::condition_variable changed;
+  bool stop = false;      // cancelled or failed; wakes every waiter
+  bool allQueued = false; // the calling thread has recorded its last frame
+  int framesQueued = 0;
+  QString writerError;
+  std::atomic<int64_t> rasterNanos{0};
+
+  std::thread writer([&] {
+    Tracer::setThreadName("export writer");
+    if (!sink.open(info, settings_.fps)) {
+      std::lock_guard<std::mutex> lock(mutex);
+      writerError = sink.errorString();
+      stop = true;
+      changed.notify_all();
+      return;
+    }
+
+    for (int frame = 0;; ++frame) {
+      Slot &slot = ring[frame % ringSize];
+      {
+        std::unique_lock<std::mutex> lock(mutex);
+        changed.wait(lock, [&] {
+          return stop ||
+                 (slot.frame == frame && slot.state == Slot::State::Ready) ||
+                 (allQueued && frame >= framesQueued);
+        });
+        if (stop || slot.frame != frame || slot.state != Slot::State::Ready)
+          break;
+      }
+
+      const auto writeStart = Clock::now();
+      bool ok;
+      {
+        TraceSpan span("export", "sink write", "frame", frame);
+        ok = sink.write(frame, SkPixmap(info, slot.pixels.get(), rowBytes));
+      }
+      result.writeSeconds += secondsSince(writeStart);
+
+      std::lock_guard<std::mutex> lock(mutex);
+      if (!ok) {
+        writerError = sink.errorString().isEmpty()
+                          ? QString("Frame %1 could not be written").arg(frame)
+                          : sink.errorString();
+        stop = true;
+        changed.notify_all();
+        break;
+      }
+      ++result.framesWritten;
+      slot.state = Slot::State::Free;
+      slot.frame = -1;
+      changed.notify_all();
+    }
+
+    if (!sink.close()) {
+      std::lock_guard<std::mutex> lock(mutex);
+      if (writerError.isEmpty())
+        writerError = sink.errorString();
+    }
+  });
+
+  QThreadPool pool;
+  pool.setMaxThreadCount(threads);
+
+  // Export frames are not editor frames.
+  FrameProfiler::Suspend suspendProfiler(scene_.profiler());
+  const auto start = Clock::now();
+  for (int i = 0; i < settings_.frameCount; ++i) {
+    if (progress && !progress(i)) {
+      result.cancelled = true;
+      break;
+    }
+
+    // Wait for the writer to hand this frame's buffer back.
+    Slot &slot = ring[i % ringSize];
+    {
+      TraceSpan span("export", "wait for buffer", "frame", i);
+      std::unique_lock<std::mutex> lock(mutex);
+      changed.wait(lock,
+                   [&] { return stop || slot.state == Slot::State::Free; });
+      if (stop)
+        break;
+    }
+
+    TraceSpan recordSpan("export", "record frame", "frame", i);
+    const auto recordStart = Clock::now();
+    const float time =
+        settings_.startTime + static_cast<float>(i) / settings_.fps;
+    {
+      FrameProfiler::Scope scope(scene_.profiler(), FramePhase::LuaTick);
+      scene_.getScriptSystem().tick(dt, time);
+    }
+
+    SkPictureRecorder recorder;
+    SkCanvas *canvas = recorder.beginRecording(bounds);
+    canvas->concat(settings_.transform);
+    scene_.draw(canvas, time);
+    sk_sp<SkPicture> picture = recorder.finishRecordingAsPicture();
+    // The picture holds copies of everything it needs.
+    scene_.frameArena().reset();
+    result.recordSeconds += secondsSince(recordStart);
+
+    {
+      std::lock_guard<std::mutex> lock(mutex);
+      slot.state = Slot::State::Rendering;
+      slot.frame = i;
+      ++framesQueued;
+    }
+    QtConcurrent::run(&pool, [&, picture, target = &slot, frame = i] {
+      TraceSpan span("raster", "rasterize frame", "frame", frame);
+      const auto rasterStart = Clock::now();
+      SkCanvas *canvas = target->surface->getCanvas();
+      canvas->clear(settings_.clearColor);
+      canvas->drawPicture(picture);
+      rasterNanos += std::chrono::duration_cast<std::chrono::nanoseconds>(
+                         Clock::now() - rasterStart)
+                         .count();
+
+      std::lock_guard<std::mutex> lock(mutex);
+      target->state = Slot::State::Ready;
+      changed.notify_all();
+    });
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(mutex);
+    allQueued = true;
+    if (result.cancelled)
+      stop = true;
+    changed.notify_all();
+  }
+  // Workers and the writer reference the ring; both must be done first.
+  pool.waitForDone();
+  writer.join();
+
+  result.error = writerError;
+  result.wallSeconds = secondsSince(start);
+  result.rasterSeconds = rasterNanos / 1e9;
+  return result;
+}
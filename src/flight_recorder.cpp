@@ -0,0 +1,143 @@
+#include "flight_recorder.h"
+
+#include <QDateTime>
+#include <QDebug>
+#include <QDir>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <algorithm>
+
+namespace {
+QJsonObject toJson(const FrameSample &sample) {
+  QJsonObject phases;
+  for (int i = 0; i < kFramePhaseCount; ++i)
+    phases[framePhaseName(static_cast<FramePhase>(i))] = sample.phaseMs[i];
+
+  QJsonObject o;
+  o["frame"] = static_cast<qint64>(sample.frame);
+  o["wallMs"] = sample.wallMs;
+  o["revision"] = static_cast<qint64>(sample.revision);
+  o["timelineSeconds"] = sample.timelineSeconds;
+  o["totalMs"] = sample.totalMs;
+  o["phasesMs"] = phases;
+  o["entitiesDrawn"] = static_cast<qint64>(sample.entitiesDrawn);
+  o["entitiesReplayed"] = static_cast<qint64>(sample.entitiesReplayed);
+  o["entitiesCulled"] = static_cast<qint64>(sample.entitiesCulled);
+  o["luaCalls"] = static_cast<qint64>(sample.luaCalls);
+  o["cppCalls"] = static_cast<qint64>(sample.cppCalls);
+  if (sample.allocs > 0) {
+    QJsonObject phaseAllocs;
+    for (int i = 0; i < kFramePhaseCount; ++i)
+      phaseAllocs[framePhaseName(static_cast<FramePhase>(i))] =
+          static_cast<qint64>(sample.phaseAllocs[i]);
+    o["allocs"] = static_cast<qint64>(sample.allocs);
+    o["allocBytes"] = static_cast<qint64>(sample.allocBytes);
+    o["luaAllocs"] = static_cast<qint64>(sample.luaAllocs);
+    o["phaseAllocs"] = phaseAllocs;
+  }
+  if (sample.systemCount > 0) {
+    QJsonArray systems;
+    for (int i = 0; i < sample.systemCount; ++i) {
+      QJsonObject s;
+      s["name"] = QString::fromUtf8(sample.systems[i].name);
+      s["ms"] = sample.systems[i].ms;
+      s["entities"] = sample.systems[i].entities;
+      systems.append(s);
+    }
+    o["systems"] = systems;
+  }
+  return o;
+}
+} // namespace
+
+QString FlightRecorder::frameEnded(double paintMs) {
+  const double updateMs = updateMs_;
+  updateMs_ = 0;
+  if (samples_.pushed() == 0)
+    return {};
+  const std::vector<FrameSample> newest = samples_.recent(1);
+  if (newest.empty() || newest.back().frame == lastFrame_)
+    return {}; // profiling is off, nothing was committed
+  lastFrame_ = newest.back().frame;
+
+  const char *reason = nullptr;
+  double ms = 0;
+  if (updateMs > settings_.budgetMs) {
+    reason = "update";
+    ms = updateMs;
+  } else if (paintMs > settings_.budgetMs) {
+    reason = "paint";
+    ms = paintMs;
+  }
+  if (!reason)
+    return {};
+  const double wallMs = newest.back().wallMs;
+  if (lastDumpWallMs_ >= 0 &&
+      wallMs - lastDumpWallMs_ < settings_.windowSeconds * 1000)
+    return {};
+  lastDumpWallMs_ = wallMs;
+  return dump(reason, ms);
+}
+
+QString FlightRecorder::dump(const char *reason, double ms) {
+  std::vector<FrameSample> frames =
+      samples_.recent(FrameSampleRing::kCapacity);
+  if (frames.empty())
+    return {};
+  const FrameSample &slow = frames.back();
+  const double since = slow.wallMs - settings_.windowSeconds * 1000;
+  QJsonArray list;
+  double firstMs = slow.wallMs;
+  for (const FrameSample &f : frames)
+    if (f.wallMs >= since) {
+      firstMs = std::min(firstMs, f.wallMs);
+      list.append(toJson(f));
+    }
+  // The ring, or the session, may be shorter than the window.
+  const double coveredSeconds = (slow.wallMs - firstMs) / 1000;
+  const bool truncated = frames.front().wallMs > since;
+
+  QJsonObject root;
+  root["reason"] = reason;
+  root["triggerMs"] = ms;
+  root["budgetMs"] = settings_.budgetMs;
+  root["windowSeconds"] = settings_.windowSeconds;
+  root["coveredSeconds"] = coveredSeconds;
+  root["truncated"] = truncated;
+  root["revision"] = static_cast<qint64>(slow.revision);
+  root["timelineSeconds"] = slow.timelineSeconds;
+  root["recordedAt"] = QDateTime::currentDateTime().toString(Qt::ISODate);
+  root["frames"] = list;
+
+  const QString directory =
+      settings_.directory.isEmpty()
+          ? QDir::temp().filePath("animator-flight")
+          : settings_.directory;
+  QDir().mkpath(directory);
+  const QString path = QDir(directory).filePath(
+      QString("slow-frame-%1-%2.json")
+          .arg(QDateTime::currentDateTime().toString("yyyyMMdd-HHmmss"))
+          .arg(slow.frame));
+  QFile file(path);
+  if (!file.open(QIODevice::WriteOnly) ||
+      file.write(QJsonDocument(root).toJson()) < 0) {
+    qWarning() << "Flight recorder: could not write" << path;
+    return {};
+  }
+  ++dumps_;
+  qWarning().noquote() << QString("Slow %1 (%2 ms, budget %3 ms) at t=%4 s, "
+                                  "revision %5; last %6 frames (%7 s) written "
+                                  "to %8")
+                              .arg(reason)
+                              .arg(ms, 0, 'f', 1)
+                              .arg(settings_.budgetMs, 0, 'f', 1)
+                              .arg(slow.timelineSeconds, 0, 'f', 2)
+                              .arg(slow.revision)
+                              .arg(list.size())
+                              .arg(coveredSeconds, 0, 'f', 1)
+                              .arg(path);
+  return path;
+}
@@ -0,0 +1,71 @@
+#include "frame_cache.h"
+
+#include <cmath>
+
+FrameCache::FrameCache(size_t budgetBytes, float timeStep)
+    : budget_(budgetBytes), timeStep_(timeStep) {}
+
+int64_t FrameCache::tickOf(float time) const {
+  return static_cast<int64_t>(std::floor(time / timeStep_ + 0.5f));
+}
+
+void FrameCache::syncRevision(uint64_t revision) {
+  if (revision == revision_)
+    return;
+  // Revisions only grow, so frames of an older scene never come back.
+  clear();
+  revision_ = revision;
+}
+
+sk_sp<SkPicture> FrameCache::find(int64_t tick, uint64_t revision) {
+  syncRevision(revision);
+  auto it = entries_.find(tick);
+  if (it == entries_.end())
+    return nullptr;
+  lru_.splice(lru_.begin(), lru_, it->second.lruPos);
+  return it->second.picture;
+}
+
+void FrameCache::insert(int64_t tick, uint64_t revision,
+                        sk_sp<SkPicture> picture) {
+  syncRevision(revision);
+  if (!picture)
+    return;
+
+  auto it = entries_.find(tick);
+  if (it != entries_.end()) {
+    bytesUsed_ -= it->second.bytes;
+    lru_.erase(it->second.lruPos);
+    entries_.erase(it);
+  }
+
+  Entry entry;
+  entry.bytes = picture->approximateBytesUsed();
+  entry.picture = std::move(picture);
+  lru_.push_front(tick);
+  entry.lruPos = lru_.begin();
+  bytesUsed_ += entry.bytes;
+  entries_.emplace(tick, std::move(entry));
+  evictToBudget();
+}
+
+void FrameCache::clear() {
+  entries_.clear();
+  lru_.clear();
+  bytesUsed_ = 0;
+}
+
+void FrameCache::setBudget(size_t bytes) {
+  budget_ = bytes;
+  evictToBudget();
+}
+
+void FrameCache::evictToBudget() {
+  // The most recent frame stays even if it alone exceeds the budget.
+  while (bytesUsed_ > budget_ && lru_.size() > 1) {
+    auto it = entries_.find(lru_.back());
+    bytesUsed_ -= it->second.bytes;
+    entries_.erase(it);
+    lru_.pop_back();
+  }
+}
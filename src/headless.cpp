@@ -0,0 +1,194 @@
+#include "headless.h"
+#include "exporter.h"
+#include "memory_report.h"
+#include "scene.h"
+#include "trace.h"
+
+#include <QCommandLineParser>
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QFile>
+#include <QFileInfo>
+#include <QJsonDocument>
+#include <QJsonObject>
+
+#include <cmath>
+#include <cstring>
+#include <iostream>
+
+bool isHeadlessInvocation(int argc, char **argv) {
+  for (int i = 1; i < argc; ++i)
+    if (std::strcmp(argv[i], "--headless") == 0)
+      return true;
+  return false;
+}
+
+int runHeadless(int argc, char **argv) {
+  QCoreApplication app(argc, argv);
+
+  QCommandLineParser parser;
+  parser.setApplicationDescription(
+      "Render a scene on the CPU without opening a window.");
+  parser.addHelpOption();
+  parser.addPositionalArgument("scene", "Scene JSON saved by the editor.");
+  QCommandLineOption headlessOpt("headless", "Run without a display.");
+  QCommandLineOption outputOpt(
+      {"o", "output"},
+      "Output .mp4 file, or a directory for an image sequence.", "path");
+  QCommandLineOption formatOpt(
+      "format", "Image sequence format: png, webp (lossless) or raw RGBA.",
+      "format", "png");
+  QCommandLineOption encodersOpt(
+      "encoders", "Image encoder threads, 0 for one per core.", "n", "0");
+  QCommandLineOption widthOpt("width", "Output width in pixels.", "px",
+                              "1920");
+  QCommandLineOption heightOpt("height", "Output height in pixels.", "px",
+                               "1080");
+  QCommandLineOption fpsOpt("fps", "Frames per second.", "fps", "60");
+  QCommandLineOption startOpt("start", "First frame time in seconds.", "s",
+                              "0");
+  QCommandLineOption endOpt("end", "End time in seconds (exclusive).", "s",
+                            "5");
+  QCommandLineOption viewOpt(
+      "view", "Scene area that is fit into the output, as WxH. Defaults to "
+              "the output size, i.e. one scene unit per pixel.",
+      "WxH");
+  QCommandLineOption threadsOpt(
+      "threads", "Rasterization threads, 0 for one per core.", "n", "0");
+  QCommandLineOption summaryOpt(
+      "summary", "Write the JSON timing summary here instead of stdout.",
+      "file");
+  QCommandLineOption traceOpt(
+      "trace", "Record a Chrome trace of loading and rendering to this file.",
+      "file");
+  QCommandLineOption traceEntitiesOpt(
+      "trace-entities", "With --trace, add a span for every script call.");
+  QCommandLineOption memoryOpt(
+      "memory-report",
+      "Write a JSON memory report of the scene after rendering to this file.",
+      "file");
+  parser.addOptions({headlessOpt, outputOpt, formatOpt, encodersOpt,
+                     widthOpt, heightOpt, fpsOpt, startOpt, endOpt, viewOpt,
+                     threadsOpt, summaryOpt, traceOpt, traceEntitiesOpt,
+                     memoryOpt});
+  parser.process(app);
+
+  auto fail = [](const QString &message) {
+    std::cerr << "animator: " << message.toStdString() << std::endl;
+    return 2;
+  };
+
+  const QStringList positional = parser.positionalArguments();
+  if (positional.size() != 1)
+    return fail("expected exactly one scene file");
+  if (!parser.isSet(outputOpt))
+    return fail("--output is required");
+  ImageSequenceSink::Format format;
+  if (!ImageSequenceSink::parseFormat(parser.value(formatOpt), format))
+    return fail("--format must be png, webp or raw");
+
+  FrameExporter::Settings settings;
+  settings.width = parser.value(widthOpt).toInt();
+  settings.height = parser.value(heightOpt).toInt();
+  settings.fps = parser.value(fpsOpt).toInt();
+  settings.threads = parser.value(threadsOpt).toInt();
+  settings.startTime = parser.value(startOpt).toFloat();
+  const float endTime = parser.value(endOpt).toFloat();
+  if (settings.width <= 0 || settings.height <= 0 || settings.fps <= 0)
+    return fail("width, height and fps must be positive");
+  settings.frameCount = static_cast<int>(
+      std::lround((endTime - settings.startTime) * settings.fps));
+  if (settings.frameCount <= 0)
+    return fail("--end must be after --start");
+
+  float viewWidth = settings.width, viewHeight = settings.height;
+  if (parser.isSet(viewOpt)) {
+    const QStringList parts = parser.value(viewOpt).split('x');
+    if (parts.size() != 2 || parts[0].toFloat() <= 0 ||
+        parts[1].toFloat() <= 0)
+      return fail("--view must look like 1280x720");
+    viewWidth = parts[0].toFloat();
+    viewHeight = parts[1].toFloat();
+  }
+  settings.transform = FrameExporter::fitTransform(viewWidth, viewHeight,
+                                                   settings.width,
+                                                   settings.height);
+
+  if (parser.isSet(traceOpt))
+    Tracer::start(parser.isSet(traceEntitiesOpt) ? Tracer::Level::Entities
+                                                 : Tracer::Level::Frames);
+
+  // Load the scene ----------------------------------------------------------
+  QElapsedTimer loadTimer;
+  loadTimer.start();
+  const QString scenePath = positional.first();
+  QFile file(scenePath);
+  if (!file.open(QIODevice::ReadOnly))
+    return fail(QString("could not open %1").arg(scenePath));
+  const QJsonDocument doc = QJsonDocument::fromJson(file.readAll());
+  if (!doc.isObject())
+    return fail(QString("%1 is not a scene file").arg(scenePath));
+
+  Scene scene(nullptr);
+  scene.deserialize(doc.object());
+  scene.getScriptSystem().resetEnvironments();
+  const double loadSeconds = loadTimer.elapsed() / 1000.0;
+
+  // Render ------------------------------------------------------------------
+  const QString output = parser.value(outputOpt);
+  std::unique_ptr<FrameSink> sink;
+  if (output.endsWith(".mp4", Qt::CaseInsensitive))
+    sink = std::make_unique<FfmpegSink>(output);
+  else
+    sink = std::make_unique<ImageSequenceSink>(
+        output, format, parser.value(encodersOpt).toInt());
+
+  FrameExporter exporter(scene, settings);
+  const FrameExporter::Result result = exporter.run(*sink);
+
+  QString traceError;
+  if (parser.isSet(traceOpt) &&
+      !Tracer::stop(parser.value(traceOpt), &traceError))
+    std::cerr << "animator: " << traceError.toStdString() << std::endl;
+
+  // Measured after rendering, when the caches hold what the export needed.
+  if (parser.isSet(memoryOpt)) {
+    const MemoryReport report = measureSceneMemory(scene);
+    const QString memoryPath = parser.value(memoryOpt);
+    QFile memoryFile(memoryPath);
+    if (!memoryFile.open(QIODevice::WriteOnly) ||
+        memoryFile.write(QJsonDocument(report.toJson()).toJson()) < 0)
+      std::cerr << "animator: could not write " << memoryPath.toStdString()
+                << std::endl;
+  }
+
+  QJsonObject summary = result.toJson();
+  summary["scene"] = QFileInfo(scenePath).absoluteFilePath();
+  summary["output"] = output;
+  summary["width"] = settings.width;
+  summary["height"] = settings.height;
+  summary["fpsTarget"] = settings.fps;
+  summary["start"] = settings.startTime;
+  summary["end"] = endTime;
+  summary["loadSeconds"] = loadSeconds;
+  const QByteArray json =
+      QJsonDocument(summary).toJson(QJsonDocument::Compact);
+
+  // Scene setup may print to stdout, so the summary goes last on its own line.
+  const QString summaryPath = parser.value(summaryOpt);
+  if (summaryPath.isEmpty() || summaryPath == "-") {
+    std::cout << json.constData() << std::endl;
+  } else {
+    QFile summaryFile(summaryPath);
+    if (!summaryFile.open(QIODevice::WriteOnly) ||
+        summaryFile.write(json + '\n') < 0)
+      std::cerr << "animator: could not write " << summaryPath.toStdString()
+                << std::endl;
+  }
+
+  if (!result.error.isEmpty()) {
+    std::cerr << "animator: " << result.error.toStdString() << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -1,9 +1,14 @@
 #include "camera.h"
+#include "headless.h"
 #include "window.h"
 #include <QApplication>
 #include <QSurfaceFormat>
 
 int main(int argc, char **argv) {
+  // Command-line rendering for machines without a display
+  if (isHeadlessInvocation(argc, argv))
+    return runHeadless(argc, argv);
+
   QSurfaceFormat fmt;
   fmt.setRenderableType(QSurfaceFormat::OpenGL);
   fmt.setProfile(QSurfaceFormat::CoreProfile);
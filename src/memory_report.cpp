@@ -0,0 +1,155 @@
+#include "memory_report.h"
+#include "scene.h"
+
+#include "include/core/SkGraphics.h"
+
+#include <QJsonArray>
+#include <QTextStream>
+
+#include <algorithm>
+#include <map>
+
+void MemoryReport::Section::add(const std::string &name, uint64_t count,
+                                uint64_t bytes) {
+  for (Entry &entry : entries)
+    if (entry.name == name) {
+      entry.count += count;
+      entry.bytes += bytes;
+      return;
+    }
+  entries.push_back({name, count, bytes});
+}
+
+uint64_t MemoryReport::Section::bytes() const {
+  uint64_t total = 0;
+  for (const Entry &entry : entries)
+    total += entry.bytes;
+  return total;
+}
+
+MemoryReport::Section &MemoryReport::section(const std::string &title) {
+  for (Section &s : sections)
+    if (s.title == title)
+      return s;
+  sections.push_back({title, {}});
+  return sections.back();
+}
+
+uint64_t MemoryReport::totalBytes() const {
+  uint64_t total = 0;
+  for (const Section &s : sections)
+    total += s.bytes();
+  return total;
+}
+
+QJsonObject MemoryReport::toJson() const {
+  QJsonObject root;
+  for (const Section &s : sections) {
+    QJsonArray entries;
+    for (const Entry &entry : s.entries) {
+      QJsonObject o;
+      o["name"] = QString::fromStdString(entry.name);
+      o["count"] = static_cast<qint64>(entry.count);
+      o["bytes"] = static_cast<qint64>(entry.bytes);
+      entries.append(o);
+    }
+    QJsonObject section;
+    section["bytes"] = static_cast<qint64>(s.bytes());
+    section["entries"] = entries;
+    root[QString::fromStdString(s.title)] = section;
+  }
+  root["totalBytes"] = static_cast<qint64>(totalBytes());
+  return root;
+}
+
+QString MemoryReport::toText() const {
+  auto mib = [](uint64_t bytes) {
+    return QString::number(bytes / (1024.0 * 1024.0), 'f', 2) + " MiB";
+  };
+  QString text;
+  QTextStream out(&text);
+  for (const Section &s : sections) {
+    out << QString::fromStdString(s.title) << ": " << mib(s.bytes()) << '\n';
+    std::vector<Entry> entries = s.entries;
+    std::sort(entries.begin(), entries.end(),
+              [](const Entry &a, const Entry &b) { return a.bytes > b.bytes; });
+    for (const Entry &entry : entries)
+      out << "  " << QString::fromStdString(entry.name).leftJustified(32)
+          << QString::number(entry.count).rightJustified(10)
+          << mib(entry.bytes).rightJustified(14) << '\n';
+  }
+  out << "total: " << mib(totalBytes()) << '\n';
+  return text;
+}
+
+MemoryReport measureSceneMemory(Scene &scene) {
+  MemoryReport report;
+  flecs::world &world = scene.ecs();
+
+  // Component storage: one value per entity in the table columns. Pairs
+  // such as (Identifier, Name) count each table once.
+  MemoryReport::Section &components = report.section("flecs components");
+  world.each([&](flecs::entity c, const flecs::Component &info) {
+    if (info.size <= 0)
+      return; // tags take no storage
+    const int32_t count =
+        world.count(c) + world.count(world.pair(c, flecs::Wildcard));
+    if (count > 0)
+      components.add(c.path().c_str(), count,
+                     static_cast<uint64_t>(count) * info.size);
+  });
+
+  // What component values point to, except shapes, counted below.
+  MemoryReport::Section &heap = report.section("component heap");
+  world.each([&](const NameComponent &n) {
+    heap.add("NameComponent strings", 1, stringBytes(n.name));
+  });
+  world.each([&](const ScriptComponent &sc) {
+    heap.add("ScriptComponent strings", 1,
+             stringBytes(sc.scriptPath) + stringBytes(sc.startFunction) +
+                 stringBytes(sc.updateFunction) +
+                 stringBytes(sc.destroyFunction) +
+                 stringBytes(sc.drawFunction));
+  });
+  world.each([&](const CppScriptComponent &cs) {
+    heap.add("CppScriptComponent strings", 1,
+             stringBytes(cs.source_path) + stringBytes(cs.library_path));
+  });
+  world.each([&](const InstancedShapeComponent &instances) {
+    heap.add("InstancedShapeComponent arrays", instances.size(),
+             vectorBytes(instances.x) + vectorBytes(instances.y) +
+                 vectorBytes(instances.rotation) +
+                 vectorBytes(instances.scale) + vectorBytes(instances.color));
+  });
+
+  // Shape objects and their cached paths, by kind.
+  MemoryReport::Section &shapes = report.section("shapes by kind");
+  MemoryReport::Section &paths = report.section("cached paths by kind");
+  auto addShape = [&](const Shape *shape) {
+    if (!shape)
+      return;
+    shapes.add(shape->getKindName(), 1, shape->objectBytes());
+    paths.add(shape->getKindName(), 1, shape->pathBytes());
+  };
+  world.each([&](const ShapeComponent &sc) { addShape(sc.shape.get()); });
+  world.each([&](const InstancedShapeComponent &instances) {
+    addShape(instances.shape.get());
+  });
+
+  MemoryReport::Section &subsystems = report.section("subsystems");
+  subsystems.add("Lua heap", world.count<ScriptComponent>(),
+                 scene.getScriptSystem().getEngine().heapBytes());
+  RenderSystem &renderer = scene.getRenderer();
+  subsystems.add("render picture cache", renderer.pictureCacheSize(),
+                 renderer.pictureCacheBytes());
+  subsystems.add("instance sprites", renderer.spriteCacheSize(),
+                 renderer.spriteCacheBytes());
+  subsystems.add("frame arena", 1, scene.frameArena().capacity());
+  subsystems.add("spatial index", scene.getSpatialIndex().size(),
+                 scene.getSpatialIndex().bytesUsed());
+  subsystems.add("Skia font cache", SkGraphics::GetFontCacheCountUsed(),
+                 SkGraphics::GetFontCacheUsed());
+  subsystems.add("Skia resource cache", 0,
+                 SkGraphics::GetResourceCacheTotalBytesUsed());
+  return report;
+}
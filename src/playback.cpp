@@ -0,0 +1,40 @@
+#include "playback.h"
+
+PlaybackClock::PlaybackClock(double step, int maxStepsPerFrame)
+    : step_(step), maxStepsPerFrame_(maxStepsPerFrame) {}
+
+void PlaybackClock::start() {
+  if (running_)
+    return;
+  timer_.start();
+  lastNanos_ = 0;
+  accumulator_ = 0;
+  running_ = true;
+}
+
+void PlaybackClock::pause() { running_ = false; }
+
+int PlaybackClock::advance() {
+  if (!running_)
+    return 0;
+
+  const int64_t now = timer_.nsecsElapsed();
+  const double elapsed = (now - lastNanos_) / 1e9;
+  lastNanos_ = now;
+  stats_.wallSeconds += elapsed;
+  accumulator_ += elapsed;
+
+  int steps = static_cast<int>(accumulator_ / step_);
+  accumulator_ -= steps * step_;
+  if (steps > maxStepsPerFrame_) {
+    stats_.stepsSkipped += steps - maxStepsPerFrame_;
+    steps = maxStepsPerFrame_;
+  }
+
+  if (steps > 0) {
+    ++stats_.framesShown;
+    stats_.framesDropped += steps - 1;
+    stats_.timelineSeconds += steps * step_;
+  }
+  return steps;
+}
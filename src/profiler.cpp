@@ -0,0 +1,176 @@
+#include "profiler.h"
+
+#include <algorithm>
+#include <cstdio>
+
+const char *framePhaseName(FramePhase phase) {
+  switch (phase) {
+  case FramePhase::LuaTick:
+    return "Lua tick";
+  case FramePhase::WorldProgress:
+    return "world progress";
+  case FramePhase::CppUpdate:
+    return "C++ update";
+  case FramePhase::Render:
+    return "render";
+  case FramePhase::CppDraw:
+    return "C++ draw";
+  case FramePhase::Flush:
+    return "flush";
+  case FramePhase::Count:
+    break;
+  }
+  return "?";
+}
+
+// -------------------------------------------------------------------------
+//  FrameSampleRing
+// -------------------------------------------------------------------------
+void FrameSampleRing::push(const FrameSample &sample) {
+  const uint64_t head = head_.load(std::memory_order_relaxed);
+  slots_[head % kCapacity] = sample;
+  head_.store(head + 1, std::memory_order_release);
+}
+
+std::vector<FrameSample> FrameSampleRing::recent(size_t count) const {
+  const uint64_t head = head_.load(std::memory_order_acquire);
+  count = std::min<uint64_t>({count, head, kCapacity});
+  std::vector<FrameSample> out(count);
+  for (size_t i = 0; i < count; ++i)
+    out[i] = slots_[(head - count + i) % kCapacity];
+
+  // Once the fence shows `after`, the writer may be filling slot `after` and
+  // has finished everything before it. Both reuse the slots of the samples
+  // kCapacity older, so every copied sample older than
+  // `after + 1 - kCapacity` may be torn; the rest is intact.
+  std::atomic_thread_fence(std::memory_order_acquire);
+  const uint64_t after = head_.load(std::memory_order_relaxed);
+  const uint64_t first = head - count; // index of out[0]
+  const uint64_t firstSafe = after + 1 > kCapacity ? after + 1 - kCapacity : 0;
+  if (firstSafe > first)
+    out.erase(out.begin(),
+              out.begin() + std::min<uint64_t>(firstSafe - first, count));
+  return out;
+}
+
+// -------------------------------------------------------------------------
+//  FrameProfiler
+// -------------------------------------------------------------------------
+void FrameProfiler::setEnabled(bool enabled) {
+  if (enabled == enabled_)
+    return;
+  enabled_ = enabled;
+  std::fill(std::begin(pending_), std::end(pending_), 0.0);
+  std::fill(std::begin(pendingAllocs_), std::end(pendingAllocs_),
+            AllocCounts{});
+  cppCalls_ = 0;
+  lastLuaCalls_ = luaCalls_;
+  lastAllocs_ = AllocTracker::counts();
+}
+
+void FrameProfiler::setSystemTimingEnabled(bool enabled) {
+  if (enabled == systemTiming_)
+    return;
+  systemTiming_ = enabled;
+  ecs_measure_system_time(world_.c_ptr(), enabled);
+  lastSystemTime_.clear();
+}
+
+void FrameProfiler::addPhaseTime(FramePhase phase, double ms) {
+  pending_[static_cast<int>(phase)] += ms;
+}
+
+void FrameProfiler::movePhaseTime(FramePhase from, FramePhase to,
+                                  double ms) {
+  pending_[static_cast<int>(from)] -= ms;
+  pending_[static_cast<int>(to)] += ms;
+}
+
+void FrameProfiler::addPhaseAllocs(FramePhase phase,
+                                   const AllocCounts &allocs) {
+  pendingAllocs_[static_cast<int>(phase)] += allocs;
+}
+
+void FrameProfiler::movePhaseAllocs(FramePhase from, FramePhase to,
+                                    const AllocCounts &allocs) {
+  // Unsigned, but `from` enclosed the work and already counted it.
+  pendingAllocs_[static_cast<int>(from)] =
+      pendingAllocs_[static_cast<int>(from)] - allocs;
+  pendingAllocs_[static_cast<int>(to)] += allocs;
+}
+
+void FrameProfiler::endFrame(double paintMs, const FrameInfo &info) {
+  if (!enabled_)
+    return;
+
+  FrameSample sample;
+  sample.frame = frame_++;
+  sample.wallMs = clock_.nsecsElapsed() / 1e6;
+  sample.revision = info.revision;
+  sample.timelineSeconds = info.timelineSeconds;
+  for (int i = 0; i < kFramePhaseCount; ++i)
+    sample.phaseMs[i] = static_cast<float>(std::max(0.0, pending_[i]));
+  sample.totalMs = static_cast<float>(
+      paintMs + sample.phaseMsOf(FramePhase::LuaTick) +
+      sample.phaseMsOf(FramePhase::WorldProgress) +
+      sample.phaseMsOf(FramePhase::CppUpdate));
+  sample.entitiesDrawn = info.drawn;
+  sample.entitiesReplayed = info.replayed;
+  sample.entitiesCulled = info.culled;
+  sample.luaCalls = static_cast<uint32_t>(luaCalls_ - lastLuaCalls_);
+  lastLuaCalls_ = luaCalls_;
+  sample.cppCalls = cppCalls_;
+  if (systemTiming_)
+    sampleSystems(sample);
+
+  for (int i = 0; i < kFramePhaseCount; ++i) {
+    sample.phaseAllocs[i] =
+        static_cast<uint32_t>(pendingAllocs_[i].totalCount());
+    sample.phaseAllocBytes[i] =
+        static_cast<uint32_t>(pendingAllocs_[i].totalBytes());
+  }
+  const AllocCounts now = AllocTracker::counts();
+  const AllocCounts frame = now - lastAllocs_;
+  lastAllocs_ = now;
+  sample.allocs = static_cast<uint32_t>(frame.totalCount());
+  sample.allocBytes = frame.totalBytes();
+  sample.luaAllocs = static_cast<uint32_t>(frame.luaCount);
+  sample.luaAllocBytes = frame.luaBytes;
+  ring_.push(sample);
+
+  std::fill(std::begin(pending_), std::end(pending_), 0.0);
+  std::fill(std::begin(pendingAllocs_), std::end(pendingAllocs_),
+            AllocCounts{});
+  cppCalls_ = 0;
+}
+
+void FrameProfiler::sampleSystems(FrameSample &sample) {
+  // flecs keeps a running total per system; a frame's share is the delta.
+  world_.each(flecs::System, [&](flecs::entity e) {
+    const ecs_system_t *system = ecs_system_get(world_.c_ptr(), e);
+    if (!system)
+      return;
+    const double spent = system->time_spent * 1000.0;
+    auto last = std::find_if(
+        lastSystemTime_.begin(), lastSystemTime_.end(),
+        [&](const auto &entry) { return entry.first == e.id(); });
+    if (last == lastSystemTime_.end()) {
+      lastSystemTime_.emplace_back(e.id(), spent);
+      return; // no previous total to diff against yet
+    }
+    const double ms = spent - last->second;
+    last->second = spent;
+
+    if (sample.systemCount == FrameSample::kMaxSystems)
+      return;
+    SystemSample &out = sample.systems[sample.systemCount++];
+    const char *name = system->name ? system->name : e.name().c_str();
+    if (name && *name)
+      std::snprintf(out.name, sizeof(out.name), "%s", name);
+    else
+      std::snprintf(out.name, sizeof(out.name), "#%llu",
+                    static_cast<unsigned long long>(e.id()));
+    out.ms = static_cast<float>(ms);
+    out.entities = system->query ? ecs_query_count(system->query).entities : 0;
+  });
+}
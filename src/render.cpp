@@ -1,51 +1,586 @@
 #include "render.h"
+#include "memory_report.h"
+#include "trace.h"
+
+#include "include/core/SkBBHFactory.h"
+#include "include/core/SkPictureRecorder.h"
+#include "include/core/SkSamplingOptions.h"
+#include "include/core/SkShader.h"
+#include "include/core/SkSurface.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Renders an entity must stay unchanged before it is folded into a recorded
+// picture; keeps entities that are being dragged or edited out of the cache.
+constexpr uint32_t kStaticAfterFrames = 3;
+
+// Keeps a merged path, and the work lost when it is culled, bounded.
+constexpr size_t kMaxBatchSize = 256;
+
+// Instanced shapes larger than this on screen are drawn as paths instead of
+// a sprite, which would need too much memory to stay sharp.
+constexpr int kMaxSpritePixels = 256;
+
+// Pictures are recorded in world space. The R-tree lets playback skip
+// operations outside the current clip, so the bounds only need to be large.
+const SkRect kPictureBounds = SkRect::MakeLTRB(-1e6f, -1e6f, 1e6f, 1e6f);
+
+inline uint64_t mixKey(uint64_t h, uint64_t v) {
+  return h ^ (v + 0x9e3779b97f4a7c15ULL + (h << 6) + (h >> 2));
+}
+
+void bumpVersion(flecs::entity e) {
+  auto &v = e.ensure<RenderVersionComponent>();
+  ++v.version;
+  v.stableFrames = 0;
+}
+} // namespace
+
+RenderSystem::RenderSystem(flecs::world &w, ScriptSystem &ss)
+    : world_(w), scriptSystem_(ss) {
+  // Named queries are owned by the world, so they are released together with
+  // it regardless of member destruction order in Scene.
+  // WorldBoundsComponent only exists on entities the spatial index saw with
+  // a shape or instanced shape; collect() skips the rare table with neither.
+  auto drawQuery = [this](const char *name) {
+    return world_.query_builder<
+        const TransformComponent, const ShapeComponent *,
+        const InstancedShapeComponent *, const MaterialComponent,
+        PaintCacheComponent, RenderVersionComponent,
+        const WorldBoundsComponent, const AnimationComponent *,
+        const PathEffectComponent *, ScriptComponent *,
+        const CppScriptComponent *>(name);
+  };
+  backgroundQuery_ = drawQuery("RenderQueue::Background")
+                         .with<SceneBackgroundComponent>()
+                         .cached()
+                         .build();
+  foregroundQuery_ = drawQuery("RenderQueue::Foreground")
+                         .without<SceneBackgroundComponent>()
+                         .cached()
+                         .build();
+
+  // Paint caches are created alongside the material and invalidated whenever
+  // the material or path effect is set or flagged with modified<>().
+  world_.observer<const MaterialComponent>()
+      .event(flecs::OnSet)
+      .each([](flecs::entity e, const MaterialComponent &) {
+        e.ensure<PaintCacheComponent>().dirty = true;
+        bumpVersion(e);
+      });
+  world_.observer<const PathEffectComponent>()
+      .event(flecs::OnSet)
+      .event(flecs::OnRemove)
+      .each([](flecs::entity e, const PathEffectComponent &) {
+        if (e.has<PaintCacheComponent>()) {
+          auto &paints = e.ensure<PaintCacheComponent>();
+          paints.dirty = paints.effectDirty = true;
+        }
+        bumpVersion(e);
+      });
+  world_.observer<const TransformComponent>()
+      .event(flecs::OnSet)
+      .each([](flecs::entity e, const TransformComponent &) {
+        bumpVersion(e);
+      });
+  world_.observer<const ShapeComponent>()
+      .event(flecs::OnSet)
+      .each([](flecs::entity e, const ShapeComponent &) { bumpVersion(e); });
+  world_.observer<const InstancedShapeComponent>()
+      .event(flecs::OnSet)
+      .each([](flecs::entity e, const InstancedShapeComponent &) {
+        bumpVersion(e);
+      });
+  world_.observer<const InstancedShapeComponent>()
+      .event(flecs::OnRemove)
+      .each([this](flecs::entity e, const InstancedShapeComponent &) {
+        sprites_.erase(e.id());
+        otherSprites_.erase(e.id());
+      });
+}
+
+void RenderSystem::setOffscreen(bool offscreen) {
+  if (offscreen == offscreen_)
+    return;
+  // Both sets trade places, so the drawing code fills whichever is active.
+  std::swap(pictureCache_, otherPictureCache_);
+  std::swap(sprites_, otherSprites_);
+  std::swap(frameCounter_, otherFrameCounter_);
+  std::swap(stats_, otherStats_);
+  offscreen_ = offscreen;
+}
 
 void RenderSystem::render(SkCanvas *canvas, float currentTime) {
-  std::vector<Entity> bg, fg;
+  ++frameCounter_;
+  stats_.frameHits = stats_.frameMisses = 0;
+  stats_.frameEntitiesReplayed = stats_.frameEntitiesDrawn = 0;
+  stats_.frameEntitiesCulled = stats_.frameScriptedEntities = 0;
+  stats_.frameDrawsUnbatched = stats_.frameDrawsBatched = 0;
+  stats_.frameInstancesDrawn = 0;
 
-  // Collect draw order buckets (background first)
-  world_.each<TransformComponent>([&](flecs::entity e, TransformComponent &) {
-    (e.has<SceneBackgroundComponent>() ? bg : fg).push_back(e);
-  });
+  // Everything outside the visible part of the canvas, in world units. Works
+  // for the editor view matrix and for offscreen export surfaces alike.
+  const SkRect clip = canvas->getLocalClipBounds();
+  // Taken here because static runs are recorded on an identity canvas.
+  const float maxScale = canvas->getTotalMatrix().getMaxScale();
+  viewScale_ = lodEnabled_ && maxScale > 0 ? maxScale : 0.f;
+
+  // Script draw callbacks may touch components; keep structural changes out
+  // of the way until the frame is done.
+  world_.defer_begin();
+
+  // Background first, then everything else in scene order.
+  drawList_.clear();
+  collect(backgroundQuery_, currentTime, clip);
+  collect(foregroundQuery_, currentTime, clip);
+
+  size_t i = 0;
+  while (i < drawList_.size()) {
+    const bool isStatic = drawList_[i].isStatic;
+    size_t end = i + 1;
+    while (end < drawList_.size() && drawList_[end].isStatic == isStatic)
+      ++end;
+    if (isStatic)
+      drawStaticRun(canvas, i, end);
+    else
+      drawItems(canvas, i, end, true);
+    i = end;
+  }
 
-  auto drawList = [&](const std::vector<Entity> &bucket) {
-    for (Entity e : bucket) {
-      if (!e.has<TransformComponent>() || !e.has<ShapeComponent>() ||
-          !e.has<MaterialComponent>())
+  world_.defer_end();
+
+  // Forget runs that were not part of this frame.
+  for (auto it = pictureCache_.begin(); it != pictureCache_.end();) {
+    if (it->second.lastUsedFrame != frameCounter_)
+      it = pictureCache_.erase(it);
+    else
+      ++it;
+  }
+  for (auto it = sprites_.begin(); it != sprites_.end();) {
+    if (it->second.lastUsedFrame != frameCounter_)
+      it = sprites_.erase(it);
+    else
+      ++it;
+  }
+}
+
+void RenderSystem::collect(const DrawQuery &q, float currentTime,
+                           const SkRect &clip) {
+  q.run([&](flecs::iter &it) {
+    while (it.next()) {
+      auto tr = it.field<const TransformComponent>(0);
+      // Optional columns are either present for the whole table or not at all.
+      const ShapeComponent *single =
+          it.is_set(1) ? &it.field<const ShapeComponent>(1)[0] : nullptr;
+      const InstancedShapeComponent *instanced =
+          it.is_set(2) ? &it.field<const InstancedShapeComponent>(2)[0]
+                       : nullptr;
+      if (!single && !instanced)
         continue;
-      auto &tr = e.get_mut<TransformComponent>();
-      auto &shapeCmp = e.get_mut<ShapeComponent>();
-      auto &mat = e.get_mut<MaterialComponent>();
-      if (e.has<AnimationComponent>()) {
-        auto anim = e.get<AnimationComponent>();
-        if (currentTime < anim.entryTime || currentTime > anim.exitTime)
+      auto mat = it.field<const MaterialComponent>(3);
+      auto paints = it.field<PaintCacheComponent>(4);
+      auto versions = it.field<RenderVersionComponent>(5);
+      auto bounds = it.field<const WorldBoundsComponent>(6);
+      const AnimationComponent *anim =
+          it.is_set(7) ? &it.field<const AnimationComponent>(7)[0] : nullptr;
+      const PathEffectComponent *pathEffect =
+          it.is_set(8) ? &it.field<const PathEffectComponent>(8)[0] : nullptr;
+      ScriptComponent *script =
+          it.is_set(9) ? &it.field<ScriptComponent>(9)[0] : nullptr;
+      // C++ scripts may move their entity without calling modified<>().
+      const bool hasCppScript = it.is_set(10);
+
+      for (auto i : it) {
+        // An entity with both draws its single shape, the one its bounds
+        // and picking use.
+        const InstancedShapeComponent *instances =
+            single ? nullptr : &instanced[i];
+        const Shape *shape =
+            single ? single[i].shape.get() : instanced[i].shape.get();
+        if (!shape)
+          continue;
+        if (anim && (currentTime < anim[i].entryTime ||
+                     currentTime > anim[i].exitTime))
           continue;
-      }
 
-      canvas->save();
-      canvas->translate(tr.x, tr.y);
-      canvas->rotate(tr.rotation * 180.f / M_PI);
-      canvas->scale(tr.sx, tr.sy);
-      const PathEffectComponent *pathEffect = nullptr;
-      if (e.has<PathEffectComponent>()) {
-        pathEffect = &e.get<PathEffectComponent>();
-      }
-      shapeCmp.shape->render(canvas, mat, pathEffect);
-
-      // Custom script drawing
-      if (e.has<ScriptComponent>()) {
-        auto &sc = e.get_mut<ScriptComponent>();
-        if (sc.scriptEnv.valid() && !sc.drawFunction.empty() &&
-            sc.scriptEnv[sc.drawFunction].valid()) {
-          scriptSystem_.getEngine().call_draw(sc.scriptEnv, sc.drawFunction,
-                                              canvas);
+        auto &version = versions[i];
+        // Shape edits that bypassed modified<ShapeComponent>(): draw directly
+        // this frame and let the observers refresh version and bounds once
+        // the deferred notification is flushed.
+        const bool shapeEdited = shape->isDirty();
+        if (shapeEdited) {
+          version.stableFrames = 0;
+          if (instances)
+            it.entity(i).modified<InstancedShapeComponent>();
+          else
+            it.entity(i).modified<ShapeComponent>();
+        }
+        if (version.stableFrames < kStaticAfterFrames)
+          ++version.stableFrames;
+
+        if (paints[i].dirty)
+          paints[i].rebuild(mat[i], pathEffect ? &pathEffect[i] : nullptr);
+
+        ScriptComponent *drawScript = nullptr;
+        if (script) {
+          auto &sc = script[i];
+          if (sc.scriptEnv.valid() && !sc.drawFunction.empty() &&
+              sc.scriptEnv[sc.drawFunction].valid())
+            drawScript = &sc;
         }
+        stats_.frameScriptedEntities += drawScript != nullptr;
+
+        // Script draw functions may paint anywhere, so they are never culled,
+        // and C++ scripts may have moved their entity since the bounds were
+        // last refreshed.
+        const bool isVisible = drawScript || hasCppScript || shapeEdited ||
+                               SkRect::Intersects(bounds[i].bounds, clip);
+
+        version.drawOrder = static_cast<uint32_t>(drawList_.size());
+        drawList_.push_back(
+            {it.entity(i).id(), &tr[i], shape, instances, &paints[i],
+             drawScript, version.version, bounds[i].bounds,
+             drawBoundsOutset(&mat[i], pathEffect ? &pathEffect[i] : nullptr),
+             !drawScript && !hasCppScript &&
+                 version.stableFrames >= kStaticAfterFrames,
+             isVisible});
       }
+    }
+  });
+}
 
-      canvas->restore();
+size_t RenderSystem::pictureCacheBytes() const {
+  size_t bytes = 0;
+  for (const auto *cache : {&pictureCache_, &otherPictureCache_}) {
+    bytes += hashMapBytes(*cache);
+    for (const auto &entry : *cache)
+      if (entry.second.picture)
+        bytes += entry.second.picture->approximateBytesUsed();
+  }
+  return bytes;
+}
+
+size_t RenderSystem::spriteCacheBytes() const {
+  size_t bytes = 0;
+  for (const auto *cache : {&sprites_, &otherSprites_}) {
+    bytes += hashMapBytes(*cache);
+    for (const auto &entry : *cache)
+      if (entry.second.image)
+        bytes += entry.second.image->imageInfo().computeMinByteSize();
+  }
+  return bytes;
+}
+
+float RenderSystem::pixelScaleOf(const DrawItem &item) const {
+  const TransformComponent &tr = *item.transform;
+  return viewScale_ * std::max(std::abs(tr.sx), std::abs(tr.sy));
+}
+
+void RenderSystem::drawItem(SkCanvas *canvas, const DrawItem &item) {
+  const TransformComponent &tr = *item.transform;
+  canvas->save();
+  canvas->translate(tr.x, tr.y);
+  canvas->rotate(tr.rotation * 180.f / M_PI);
+  canvas->scale(tr.sx, tr.sy);
+  const float pixelScale = pixelScaleOf(item);
+  const PaintCacheComponent *paints = item.paints;
+  if (draft_) {
+    draftPaints_ = *item.paints;
+    for (SkPaint &paint : draftPaints_.paints)
+      paint.setAntiAlias(false);
+    draftPaints_.pathEffect = nullptr;
+    paints = &draftPaints_;
+  }
+  if (item.instances)
+    drawInstances(canvas, item, *paints, pixelScale);
+  else
+    item.shape->render(canvas, *paints, pixelScale);
+
+  // Custom script drawing
+  if (item.script) {
+    TraceSpan span("lua", "on_draw", "entity", item.id,
+                   Tracer::Level::Entities);
+    scriptSystem_.getEngine().call_draw(item.script->scriptEnv,
+                                        item.script->drawFunction, canvas);
+  }
+
+  canvas->restore();
+}
+
+void RenderSystem::drawItems(SkCanvas *canvas, size_t begin, size_t end,
+                             bool cull) {
+  for (size_t i = begin; i < end; ++i) {
+    const DrawItem &item = drawList_[i];
+    if (cull) {
+      if (!item.isVisible) {
+        ++stats_.frameEntitiesCulled;
+        continue;
+      }
+      ++stats_.frameEntitiesDrawn;
     }
-  };
+    ++stats_.frameDrawsUnbatched;
+
+    const bool batchable = canBatch(item);
+    if (!batch_.empty() && !(batchable && fitsBatch(item)))
+      flushBatch(canvas);
+    if (batchable) {
+      addToBatch(i);
+    } else {
+      drawItem(canvas, item);
+      ++stats_.frameDrawsBatched;
+    }
+  }
+  flushBatch(canvas);
+}
+
+bool RenderSystem::canBatch(const DrawItem &item) const {
+  if (item.instances || item.script || item.paints->pathEffect ||
+      !item.shape->canMergePaths())
+    return false;
+  // Merged paths are stroked in world space, which only matches a stroke
+  // drawn under the entity's own scale when that scale is one.
+  const TransformComponent &tr = *item.transform;
+  return item.paints->materialStyle == PathStyle::kFill ||
+         (std::abs(tr.sx) == 1.f && std::abs(tr.sy) == 1.f);
+}
+
+int RenderSystem::mergeWinding(const DrawItem &item) const {
+  // Overlaps only draw the same pixels merged as separately when the paint
+  // covers completely and nothing depends on the shape as a whole.
+  const SkPaint &paint = item.paints->paintFor(std::nullopt);
+  const SkShader *shader = paint.getShader();
+  if (paint.getStyle() != SkPaint::kFill_Style || paint.getAlpha() != 255 ||
+      paint.asBlendMode() != SkBlendMode::kSrcOver ||
+      (shader && !shader->isOpaque()) || paint.getMaskFilter() ||
+      paint.getColorFilter() || paint.getImageFilter())
+    return 0;
+  // Shapes small enough to draw their bounds merge a clockwise rectangle.
+  const int sign =
+      item.shape->pathsToDraw(*item.paints, pixelScaleOf(item))
+          ? item.shape->windingSign()
+          : 1;
+  // A mirroring transform reverses the contours.
+  const TransformComponent &tr = *item.transform;
+  return (tr.sx < 0) != (tr.sy < 0) ? -sign : sign;
+}
+
+void RenderSystem::addToBatch(size_t index) {
+  const DrawItem &item = drawList_[index];
+  const int winding = mergeWinding(item);
+  if (batch_.empty()) {
+    batchBounds_ = item.bounds;
+    batchWinding_ = winding;
+  } else {
+    batchBounds_.join(item.bounds);
+    if (winding != batchWinding_)
+      batchWinding_ = 0;
+  }
+  batch_.push_back(index);
+}
+
+bool RenderSystem::fitsBatch(const DrawItem &item) const {
+  if (batch_.size() >= kMaxBatchSize)
+    return false;
+  const DrawItem &first = drawList_[batch_.front()];
+  if (item.paints->paintFor(std::nullopt) !=
+      first.paints->paintFor(std::nullopt))
+    return false;
+  // Opaque fills that all wind the same way merge into exactly the union
+  // the separate draws would cover, and the order of one opaque color does
+  // not matter, so they may overlap.
+  if (batchWinding_ != 0 && mergeWinding(item) == batchWinding_)
+    return true;
+  // Otherwise overlaps could cancel out or lose their draw order: the item
+  // must stay clear of everything in the batch.
+  return !SkRect::Intersects(batchBounds_, item.bounds);
+}
+
+void RenderSystem::flushBatch(SkCanvas *canvas) {
+  if (batch_.empty())
+    return;
+  ++stats_.frameDrawsBatched;
+  if (batch_.size() == 1) {
+    drawItem(canvas, drawList_[batch_.front()]);
+    batch_.clear();
+    return;
+  }
+
+  batchPath_.rewind(); // keeps the point storage for the next batch
+  for (size_t index : batch_) {
+    const DrawItem &item = drawList_[index];
+    const SkMatrix matrix = item.transform->matrix();
+    const auto *paths =
+        item.shape->pathsToDraw(*item.paints, pixelScaleOf(item));
+    if (!paths) {
+      batchPath_.addPath(SkPath::Rect(item.shape->getBoundingBox()), matrix);
+      continue;
+    }
+    for (const auto &styledPath : *paths)
+      batchPath_.addPath(styledPath.path, matrix);
+  }
+
+  SkPaint paint = drawList_[batch_.front()].paints->paintFor(std::nullopt);
+  if (draft_)
+    paint.setAntiAlias(false);
+  canvas->drawPath(batchPath_, paint);
+  batch_.clear();
+}
+
+void RenderSystem::drawInstances(SkCanvas *canvas, const DrawItem &item,
+                                 const PaintCacheComponent &paints,
+                                 float pixelScale) {
+  const InstancedShapeComponent &instances = *item.instances;
+  const size_t count = instances.size();
+  if (!count)
+    return;
+  const bool hasColors = instances.color.size() == count;
+  stats_.frameInstancesDrawn += static_cast<uint32_t>(count);
+
+  float maxScale = 0.f;
+  for (float s : instances.scale)
+    maxScale = std::max(maxScale, std::abs(s));
+
+  // One drawAtlas call for all instances, from a sprite sized for the
+  // largest one.
+  if (const InstanceSprite *sprite =
+          instanceSprite(item, paints, pixelScale * maxScale)) {
+    xforms_.resize(count);
+    spriteRects_.assign(count, SkRect::Make(sprite->image->bounds()));
+    instanceColors_.resize(count);
+    const SkColor materialColor = paints.paintFor(std::nullopt).getColor();
+    for (size_t i = 0; i < count; ++i) {
+      xforms_[i] = SkRSXform::MakeFromRadians(
+          instances.scale[i] / sprite->pixelsPerUnit, instances.rotation[i],
+          instances.x[i], instances.y[i], sprite->anchor.x(),
+          sprite->anchor.y());
+      instanceColors_[i] = hasColors ? instances.color[i] : materialColor;
+    }
+    canvas->drawAtlas(sprite->image.get(), xforms_, spriteRects_,
+                      instanceColors_, SkBlendMode::kModulate,
+                      SkSamplingOptions(SkFilterMode::kLinear), nullptr,
+                      nullptr);
+    return;
+  }
+
+  // No usable sprite: draw every instance's paths, exact at any zoom.
+  const PaintCacheComponent *instancePaints = &paints;
+  if (hasColors) {
+    instancePaints_ = paints;
+    instancePaints = &instancePaints_;
+  }
+  for (size_t i = 0; i < count; ++i) {
+    if (hasColors)
+      for (SkPaint &paint : instancePaints_.paints)
+        paint.setColor(instances.color[i]);
+    const float s = instances.scale[i];
+    canvas->save();
+    canvas->translate(instances.x[i], instances.y[i]);
+    canvas->rotate(instances.rotation[i] * 180.f / M_PI);
+    canvas->scale(s, s);
+    item.shape->render(canvas, *instancePaints, pixelScale * std::abs(s));
+    canvas->restore();
+  }
+}
+
+const RenderSystem::InstanceSprite *
+RenderSystem::instanceSprite(const DrawItem &item,
+                             const PaintCacheComponent &paints,
+                             float pixelsPerUnit) {
+  // Without a known output scale (level of detail off) a sprite could be
+  // replayed blurry, so paths are used instead.
+  if (!(pixelsPerUnit > 0.f))
+    return nullptr;
+  // Rounded up to half an octave so zooming does not rebuild every frame.
+  pixelsPerUnit = std::exp2(std::ceil(std::log2(pixelsPerUnit) * 2.f) / 2.f);
+
+  const SkRect box = item.shape->getBoundingBox().makeOutset(
+      item.outset + 1.f, item.outset + 1.f);
+  const int width = static_cast<int>(std::ceil(box.width() * pixelsPerUnit));
+  const int height = static_cast<int>(std::ceil(box.height() * pixelsPerUnit));
+  if (width <= 0 || height <= 0 || width > kMaxSpritePixels ||
+      height > kMaxSpritePixels)
+    return nullptr;
+
+  SkPaint paint = paints.paintFor(std::nullopt);
+  paint.setColor(SK_ColorWHITE);
+  const uint32_t generation = item.shape->geometryGeneration();
+
+  InstanceSprite &sprite = sprites_[item.id];
+  sprite.lastUsedFrame = frameCounter_;
+  if (sprite.image && sprite.geometryGeneration == generation &&
+      sprite.pixelsPerUnit == pixelsPerUnit && sprite.paint == paint &&
+      sprite.pathEffect == paints.pathEffect)
+    return &sprite;
+
+  sk_sp<SkSurface> surface =
+      SkSurfaces::Raster(SkImageInfo::MakeN32Premul(width, height));
+  if (!surface)
+    return nullptr;
+  instancePaints_ = paints;
+  for (SkPaint &p : instancePaints_.paints)
+    p.setColor(SK_ColorWHITE);
+  SkCanvas *spriteCanvas = surface->getCanvas();
+  spriteCanvas->clear(SK_ColorTRANSPARENT);
+  spriteCanvas->scale(pixelsPerUnit, pixelsPerUnit);
+  spriteCanvas->translate(-box.left(), -box.top());
+  item.shape->render(spriteCanvas, instancePaints_, pixelsPerUnit);
+
+  sprite.image = surface->makeImageSnapshot();
+  sprite.geometryGeneration = generation;
+  sprite.pixelsPerUnit = pixelsPerUnit;
+  sprite.paint = paint;
+  sprite.pathEffect = paints.pathEffect;
+  sprite.anchor = {-box.left() * pixelsPerUnit, -box.top() * pixelsPerUnit};
+  return &sprite;
+}
+
+void RenderSystem::drawStaticRun(SkCanvas *canvas, size_t begin, size_t end) {
+  // Draft and full quality recordings of a run are kept apart, and so are
+  // recordings for zoom levels half an octave apart, whose detail differs.
+  uint64_t key = draft_ ? 0x84222325cbf29ce4ULL : 0xcbf29ce484222325ULL;
+  if (viewScale_ > 0) {
+    const auto zoomStep =
+        static_cast<int64_t>(std::floor(std::log2(viewScale_) * 2));
+    key = mixKey(key, static_cast<uint64_t>(zoomStep));
+  }
+  for (size_t i = begin; i < end; ++i) {
+    key = mixKey(key, drawList_[i].id);
+    key = mixKey(key, drawList_[i].version);
+  }
+
+  // Runs that are entirely off screen are neither recorded nor replayed, but
+  // an existing recording is kept for when they scroll back into view.
+  size_t visible = 0;
+  for (size_t i = begin; i < end; ++i)
+    visible += drawList_[i].isVisible;
+  if (!visible) {
+    auto found = pictureCache_.find(key);
+    if (found != pictureCache_.end())
+      found->second.lastUsedFrame = frameCounter_;
+    stats_.frameEntitiesCulled += static_cast<uint32_t>(end - begin);
+    return;
+  }
+
+  // Partially visible runs are replayed whole; the picture's R-tree skips the
+  // operations outside the clip.
+  CachedPicture &cached = pictureCache_[key];
+  if (cached.picture) {
+    ++stats_.pictureHits;
+    ++stats_.frameHits;
+  } else {
+    SkPictureRecorder recorder;
+    SkRTreeFactory bbhFactory;
+    SkCanvas *recording = recorder.beginRecording(kPictureBounds, &bbhFactory);
+    drawItems(recording, begin, end, false);
+    cached.picture = recorder.finishRecordingAsPicture();
+    ++stats_.pictureMisses;
+    ++stats_.frameMisses;
+  }
+  cached.lastUsedFrame = frameCounter_;
 
-  drawList(bg);
-  drawList(fg);
+  canvas->drawPicture(cached.picture);
+  stats_.frameEntitiesReplayed += static_cast<uint32_t>(visible);
+  stats_.frameEntitiesCulled += static_cast<uint32_t>(end - begin - visible);
 }
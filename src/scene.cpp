@@ -19,10 +19,30 @@
 #include <iostream>
 #include <sys/stat.h> // for stat to check file modification times
 
+template <typename T> void Scene::trackRevision() {
+  world->observer<const T>()
+      .event(flecs::OnSet)
+      .event(flecs::OnRemove)
+      .each([this](flecs::entity, const T &) { ++revision_; });
+}
+
 Scene::Scene(SkiaCanvasWidget *canvas)
     : world(std::make_unique<flecs::world>()), scriptingEngine(*world, canvas),
-      scriptSystem(*world, scriptingEngine), renderer(*world, scriptSystem) {
+      scriptSystem(*world, scriptingEngine), renderer(*world, scriptSystem),
+      spatialIndex(*world),
+      profiler_(*world, scriptingEngine.callCount()) {
   world->set<TimeSingleton>({0.f});
+  world->set<FrameArenaSingleton>({&frameArena_});
+
+  // Everything that changes what Scene::draw produces for a given time.
+  trackRevision<TransformComponent>();
+  trackRevision<ShapeComponent>();
+  trackRevision<InstancedShapeComponent>();
+  trackRevision<MaterialComponent>();
+  trackRevision<PathEffectComponent>();
+  trackRevision<AnimationComponent>();
+  trackRevision<ScriptComponent>();
+  trackRevision<CppScriptComponent>();
 
   // --- Precompile C++ Script Header ---
   std::cout << "Checking for C++ script precompiled header..." << std::endl;
@@ -83,6 +103,7 @@ Scene::Scene(SkiaCanvasWidget *canvas)
             script.library_path + " " + script.source_path + " -I. " + includes;
 
         std::cout << "Compiling C++ script: " << command << std::endl;
+        TraceSpan span("cpp_script", "compile and load", "entity", e.id());
         int compile_ret = system(command.c_str());
         if (compile_ret != 0) {
           std::cerr << "CppScript Error: Compilation failed for "
@@ -126,12 +147,30 @@ Scene::Scene(SkiaCanvasWidget *canvas)
         dlclose(script.library_handle);
       });
 
-  world->system<CppScriptComponent>().each(
-      [this](flecs::entity e, CppScriptComponent &script) {
+  world->system<CppScriptComponent>("CppScriptUpdate")
+      .each([this](flecs::entity e, CppScriptComponent &script) {
         if (script.script_instance) {
+          QElapsedTimer timer;
+          AllocCounts allocs;
+          if (profiler_.enabled()) {
+            timer.start();
+            allocs = AllocTracker::counts();
+          }
           const auto time = world->get<TimeSingleton>();
+          TraceSpan span("cpp_script", "on_update", "entity", e.id(),
+                         Tracer::Level::Entities);
+          profiler_.countCppCall();
           script.script_instance->on_update(e, *world, world->delta_time(),
                                             time.time);
+          // Reported on its own rather than as part of world->progress.
+          if (profiler_.enabled()) {
+            profiler_.movePhaseTime(FramePhase::WorldProgress,
+                                    FramePhase::CppUpdate,
+                                    timer.nsecsElapsed() / 1e6);
+            profiler_.movePhaseAllocs(FramePhase::WorldProgress,
+                                      FramePhase::CppUpdate,
+                                      AllocTracker::counts() - allocs);
+          }
         }
       });
 }
@@ -195,15 +234,26 @@ void Scene::attachCppScript(flecs::entity e, std::string path) {
 // ---------------------------------------------------------------------
 void Scene::update(float dt, float timelineSeconds) {
   world->get_mut<TimeSingleton>().time = timelineSeconds;
+  FrameProfiler::Scope scope(profiler_, FramePhase::WorldProgress);
   world->progress(dt);
+
+  // C++ scripts may move their entity through get_mut without modified<>(),
+  // which the index observers never see.
+  world->each([this](flecs::entity e, const CppScriptComponent &) {
+    spatialIndex.refresh(e);
+  });
 }
 
 void Scene::draw(SkCanvas *canvas, float timelineSeconds) {
   // The main renderer handles shapes, materials, and probably Lua script
   // drawing.
-  renderer.render(canvas, timelineSeconds);
+  {
+    FrameProfiler::Scope scope(profiler_, FramePhase::Render);
+    renderer.render(canvas, timelineSeconds);
+  }
 
   // We explicitly iterate and draw for C++ scripts here.
+  FrameProfiler::Scope scope(profiler_, FramePhase::CppDraw);
   world->each([&](flecs::entity e, CppScriptComponent &script) {
     if (script.script_instance) {
       canvas->save();
@@ -213,6 +263,9 @@ void Scene::draw(SkCanvas *canvas, float timelineSeconds) {
         canvas->rotate(tc.rotation * 180.0f / 3.14159265359f);
         canvas->scale(tc.sx, tc.sy);
       }
+      TraceSpan span("cpp_script", "on_draw", "entity", e.id(),
+                     Tracer::Level::Entities);
+      profiler_.countCppCall();
       script.script_instance->on_draw(e, *world, canvas);
       canvas->restore();
     }
@@ -280,6 +333,15 @@ QJsonObject Scene::serialize() const {
         }
         if (e.has<SceneBackgroundComponent>())
           ent["SceneBackgroundComponent"] = true;
+        if (e.has<InstancedShapeComponent>()) {
+          auto &is = e.get<InstancedShapeComponent>();
+          if (is.shape) {
+            QJsonObject j;
+            j["kind"] = is.shape->getKindName();
+            j["properties"] = is.shape->serialize();
+            ent["InstancedShapeComponent"] = j;
+          }
+        }
         if (e.has<ShapeComponent>()) {
           auto &sh = e.get<ShapeComponent>();
           if (!sh.shape)
@@ -370,10 +432,21 @@ void Scene::deserialize(const QJsonObject &root) {
           shapePtr->deserialize(j["properties"].toObject());
         e.set<ShapeComponent>({std::move(shapePtr)});
       }
+
+      // Instanced shape --------------------------------------------------
+      if (eobj.contains("InstancedShapeComponent")) {
+        const QJsonObject j = eobj["InstancedShapeComponent"].toObject();
+        std::string kind = j["kind"].toString().toStdString();
+        auto shapePtr = ShapeFactory::create(kind);
+        if (shapePtr && j.contains("properties"))
+          shapePtr->deserialize(j["properties"].toObject());
+        e.set<InstancedShapeComponent>({std::move(shapePtr)});
+      }
     }
 }
 
 void Scene::clear() {
   world->delete_with<NameComponent>();
   kindCounters.clear();
+  renderer.clearPictureCache();
 }
@@ -1,12 +1,34 @@
 #include "scripting.h"
+#include "alloc_tracker.h"
 #include "canvas.h"
 #include "camera.h"
+#include "trace.h"
 
 #include "include/core/SkMaskFilter.h"
 #include "include/effects/SkBlurMaskFilter.h"
 
+namespace {
+// Copies every `stride`-th value of a Lua array, starting at 1-based index
+// `first`, into `dst`. Returns false if the array is too short.
+template <typename T>
+bool readArray(const sol::table &src, std::vector<T> &dst, size_t stride = 1,
+               size_t first = 1) {
+  if (dst.empty())
+    return true;
+  if (src.size() < first + (dst.size() - 1) * stride)
+    return false;
+  for (size_t i = 0; i < dst.size(); ++i)
+    dst[i] = src.raw_get<T>(first + i * stride);
+  return true;
+}
+} // namespace
+
 ScriptingEngine::ScriptingEngine(flecs::world &w, SkiaCanvasWidget *canvas)
     : lua_(), world_(w), canvas_(canvas) {
+  lua_State *L = lua_.lua_state();
+  baseAlloc_ = lua_getallocf(L, &baseAllocUd_);
+  lua_setallocf(L, &ScriptingEngine::trackingAlloc, this);
+
   Camera::setCanvas(canvas_);
   lua_.open_libraries(sol::lib::base, sol::lib::math, sol::lib::string);
 
@@ -32,6 +54,60 @@ ScriptingEngine::ScriptingEngine(flecs::world &w, SkiaCanvasWidget *canvas)
       "strokeWidth", &MaterialComponent::strokeWidth, "antiAliased",
       &MaterialComponent::antiAliased);
 
+  // Instance arrays are 1-based on the Lua side. The bulk setters take plain
+  // arrays, e.g. set_positions{x1, y1, x2, y2, ...}, and resize to match.
+  lua_.new_usertype<InstancedShapeComponent>(
+      "InstancedShapeComponent", "size", &InstancedShapeComponent::size,
+      "resize", &InstancedShapeComponent::resize, "set_shape",
+      [](InstancedShapeComponent &c, const std::string &kind) {
+        c.shape = ShapeFactory::create(kind);
+        if (!c.shape)
+          qWarning() << "Unknown shape kind for instances:" << kind.c_str();
+        return c.shape != nullptr;
+      },
+      "set",
+      sol::overload(
+          [](InstancedShapeComponent &c, size_t i, float x, float y) {
+            if (i >= 1 && i <= c.size())
+              c.set(i - 1, x, y);
+          },
+          [](InstancedShapeComponent &c, size_t i, float x, float y,
+             float rotation, float scale) {
+            if (i >= 1 && i <= c.size())
+              c.set(i - 1, x, y, rotation, scale);
+          }),
+      "set_color",
+      [](InstancedShapeComponent &c, size_t i, SkColor color) {
+        if (i >= 1 && i <= c.size())
+          c.setColor(i - 1, color);
+      },
+      "set_positions",
+      [](InstancedShapeComponent &c, const sol::table &xy) {
+        c.resize(xy.size() / 2);
+        readArray(xy, c.x, 2, 1);
+        readArray(xy, c.y, 2, 2);
+      },
+      "set_rotations",
+      [](InstancedShapeComponent &c, const sol::table &values) {
+        if (!readArray(values, c.rotation))
+          qWarning() << "set_rotations: expected" << c.size() << "values";
+      },
+      "set_scales",
+      [](InstancedShapeComponent &c, const sol::table &values) {
+        if (!readArray(values, c.scale))
+          qWarning() << "set_scales: expected" << c.size() << "values";
+      },
+      "set_colors",
+      [](InstancedShapeComponent &c, const sol::table &values) {
+        c.color.resize(c.size());
+        if (!readArray(values, c.color)) {
+          qWarning() << "set_colors: expected" << c.size() << "values";
+          c.color.clear();
+        }
+      },
+      // Back to the material color for every instance.
+      "clear_colors", [](InstancedShapeComponent &c) { c.color.clear(); });
+
   // --- Expose Skia types to Lua ---
   lua_.new_usertype<SkPoint>("Point", sol::factories(&SkPoint::Make), "x",
                              &SkPoint::fX, "y", &SkPoint::fY);
@@ -112,18 +188,37 @@ ScriptingEngine::ScriptingEngine(flecs::world &w, SkiaCanvasWidget *canvas)
       "drawPath",
       [](SkCanvas &c, const SkPath &path, const SkPaint &p) {
         c.drawPath(path, p);
+      },
+      // Device pixels per local unit, for picking a level of detail.
+      "getScale",
+      [](SkCanvas &c) {
+        const float scale = c.getTotalMatrix().getMaxScale();
+        return scale > 0 ? scale : 1.f;
       });
 
   // Minimal “registry” proxy (just the world itself)
   auto reg_type = lua_.new_usertype<flecs::world>("Registry");
-  reg_type["get_transform"] = [](flecs::world &,
-                                 Entity e) -> TransformComponent & {
+  reg_type["get_transform"] = [this](flecs::world &,
+                                     Entity e) -> TransformComponent & {
+    modifiedTransforms_.push_back(e);
     return e.get_mut<TransformComponent>();
   };
-  reg_type["get_material"] = [](flecs::world &,
-                                Entity e) -> MaterialComponent & {
+  reg_type["get_material"] = [this](flecs::world &,
+                                    Entity e) -> MaterialComponent & {
+    modifiedMaterials_.push_back(e);
     return e.get_mut<MaterialComponent>();
   };
+  reg_type["has_instances"] = [](flecs::world &, Entity e) {
+    return e.has<InstancedShapeComponent>();
+  };
+  reg_type["get_instances"] = [this](flecs::world &,
+                                     Entity e) -> InstancedShapeComponent & {
+    // Raised as a Lua error; scripts check has_instances first.
+    if (!e.has<InstancedShapeComponent>())
+      throw sol::error("get_instances: entity has no InstancedShapeComponent");
+    modifiedInstances_.push_back(e);
+    return e.get_mut<InstancedShapeComponent>();
+  };
 
   lua_["registry"] = std::ref(world_);
 
@@ -155,6 +250,7 @@ sol::table ScriptingEngine::loadScript(const std::string &path, Entity e) {
   if (path.empty() || QFileInfo(QString::fromStdString(path)).isDir()) {
     return sol::nil;
   }
+  TraceSpan span("lua", "load script", "entity", e.id());
   try {
     sol::environment env(lua_, sol::create, lua_.globals());
     env["entity_id"] = e;
@@ -186,6 +282,7 @@ sol::table ScriptingEngine::loadScript(const std::string &path, Entity e) {
 void ScriptingEngine::call(sol::table &env, const std::string &fn, float dt,
                            float t) {
   if (env.valid() && env[fn].valid()) {
+    ++callCount_;
     sol::protected_function func = env[fn];
     sol::protected_function_result result =
         func(env["entity_id"].get<Entity>(), std::ref(world_), dt, t);
@@ -193,6 +290,7 @@ void ScriptingEngine::call(sol::table &env, const std::string &fn, float dt,
       sol::error err = result;
       qWarning() << "Lua error in" << fn.c_str() << ":" << err.what();
     }
+    commitModified();
   } else {
     qWarning() << "Lua function" << fn.c_str() << "not found in script";
   }
@@ -201,6 +299,7 @@ void ScriptingEngine::call(sol::table &env, const std::string &fn, float dt,
 void ScriptingEngine::call_draw(sol::table &env, const std::string &fn,
                                 SkCanvas *canvas) {
   if (env.valid() && env[fn].valid()) {
+    ++callCount_;
     sol::protected_function func = env[fn];
     sol::protected_function_result result =
         func(env["entity_id"].get<Entity>(), std::ref(world_), canvas);
@@ -208,5 +307,36 @@ void ScriptingEngine::call_draw(sol::table &env, const std::string &fn,
       sol::error err = result;
       qWarning() << "Lua error in" << fn.c_str() << ":" << err.what();
     }
+    commitModified();
   }
 }
+
+void *ScriptingEngine::trackingAlloc(void *ud, void *ptr, size_t osize,
+                                     size_t nsize) {
+  auto *self = static_cast<ScriptingEngine *>(ud);
+  // For new blocks `osize` is a type tag, not a size.
+  if (nsize > (ptr ? osize : 0))
+    AllocTracker::noteLua(nsize);
+  return self->baseAlloc_(self->baseAllocUd_, ptr, osize, nsize);
+}
+
+size_t ScriptingEngine::heapBytes() const {
+  lua_State *L = lua_.lua_state();
+  return static_cast<size_t>(lua_gc(L, LUA_GCCOUNT)) * 1024 +
+         lua_gc(L, LUA_GCCOUNTB);
+}
+
+void ScriptingEngine::commitModified() {
+  for (Entity e : modifiedMaterials_)
+    if (e.is_alive() && e.has<MaterialComponent>())
+      e.modified<MaterialComponent>();
+  modifiedMaterials_.clear();
+  for (Entity e : modifiedTransforms_)
+    if (e.is_alive() && e.has<TransformComponent>())
+      e.modified<TransformComponent>();
+  modifiedTransforms_.clear();
+  for (Entity e : modifiedInstances_)
+    if (e.is_alive() && e.has<InstancedShapeComponent>())
+      e.modified<InstancedShapeComponent>();
+  modifiedInstances_.clear();
+}
@@ -1,50 +1,248 @@
 #include "shapes.h"
 #include "ecs.h"
 #include "include/core/SkPathMeasure.h"
+#include "include/core/SkStrokeRec.h"
 #include <QJsonArray>
 
-void Shape::render(SkCanvas *canvas, const MaterialComponent &material,
-                   const PathEffectComponent *pathEffect) const {
-  if (m_isDirty) {
-    rebuildPaths();
-    m_isDirty = false;
+#include <algorithm>
+
+namespace {
+// On-screen sizes, in pixels, where level of detail kicks in.
+constexpr float kBoundsOnlyPixels = 1.f;    // draw the bounds instead
+constexpr float kPathEffectMinPixels = 8.f; // skip path effects below
+constexpr float kFlattenBelowPixels = 64.f; // polyline curves below
+// Largest distance between a flattened curve and the real one, in pixels.
+constexpr float kFlattenTolerancePixels = 0.25f;
+
+// Bucket i of Shape::lodPaths holds on-screen sizes up to 2^(i+1) pixels.
+int lodBucket(float pixels) {
+  return std::max(0, static_cast<int>(std::ceil(std::log2(pixels))) - 1);
+}
+
+int curveSegments(const SkPoint pts[], int count, float tolerance) {
+  float length = 0;
+  for (int i = 1; i < count; ++i)
+    length += SkPoint::Distance(pts[i - 1], pts[i]);
+  return std::clamp(static_cast<int>(std::ceil(std::sqrt(length / tolerance))),
+                    1, 64);
+}
+
+void flattenQuad(SkPath &dst, const SkPoint p[3], float tolerance) {
+  const int n = curveSegments(p, 3, tolerance);
+  for (int i = 1; i <= n; ++i) {
+    const float t = static_cast<float>(i) / n, u = 1 - t;
+    dst.lineTo(u * u * p[0].fX + 2 * u * t * p[1].fX + t * t * p[2].fX,
+               u * u * p[0].fY + 2 * u * t * p[1].fY + t * t * p[2].fY);
   }
+}
 
-  for (const auto &styledPath : m_paths) {
-    SkPaint paint;
-    paint.setAntiAlias(material.antiAliased);
-    paint.setColor(material.color);
-    paint.setStrokeWidth(material.strokeWidth);
+void flattenCubic(SkPath &dst, const SkPoint p[4], float tolerance) {
+  const int n = curveSegments(p, 4, tolerance);
+  for (int i = 1; i <= n; ++i) {
+    const float t = static_cast<float>(i) / n, u = 1 - t;
+    const float a = u * u * u, b = 3 * u * u * t, c = 3 * u * t * t,
+                d = t * t * t;
+    dst.lineTo(a * p[0].fX + b * p[1].fX + c * p[2].fX + d * p[3].fX,
+               a * p[0].fY + b * p[1].fY + c * p[2].fY + d * p[3].fY);
+  }
+}
 
-    if (pathEffect) {
-      paint.setPathEffect(pathEffect->makePathEffect());
+// Replaces every curve in `src` with line segments at most `tolerance` (in
+// local units) away from it.
+SkPath flattenPath(const SkPath &src, float tolerance) {
+  SkPath dst;
+  dst.setFillType(src.getFillType());
+  SkPath::Iter iter(src, false);
+  SkPoint pts[4];
+  for (SkPath::Verb verb; (verb = iter.next(pts)) != SkPath::kDone_Verb;) {
+    switch (verb) {
+    case SkPath::kMove_Verb:
+      dst.moveTo(pts[0]);
+      break;
+    case SkPath::kLine_Verb:
+      dst.lineTo(pts[1]);
+      break;
+    case SkPath::kQuad_Verb:
+      flattenQuad(dst, pts, tolerance);
+      break;
+    case SkPath::kConic_Verb: {
+      SkPoint quads[1 + 2 * 4]; // 2^2 quads
+      const int count = SkPath::ConvertConicToQuads(
+          pts[0], pts[1], pts[2], iter.conicWeight(), quads, 2);
+      for (int i = 0; i < count; ++i)
+        flattenQuad(dst, &quads[2 * i], tolerance);
+      break;
     }
+    case SkPath::kCubic_Verb:
+      flattenCubic(dst, pts, tolerance);
+      break;
+    case SkPath::kClose_Verb:
+      dst.close();
+      break;
+    default:
+      break;
+    }
+  }
+  return dst;
+}
 
-    // Apply material properties
-    if (material.isFilled && material.isStroked) {
-      paint.setStyle(SkPaint::kStrokeAndFill_Style);
-    } else if (material.isFilled) {
-      paint.setStyle(SkPaint::kFill_Style);
-    } else if (material.isStroked) {
-      paint.setStyle(SkPaint::kStroke_Style);
+// Twice the signed area of every contour, using the control points of
+// curves; their sign is all windingSign() needs.
+double signedArea(const SkPath &path) {
+  double area = 0;
+  SkPoint start = {0, 0}, last = {0, 0};
+  auto edge = [&](const SkPoint &to) {
+    area += static_cast<double>(last.fX) * to.fY -
+            static_cast<double>(to.fX) * last.fY;
+    last = to;
+  };
+  SkPath::Iter iter(path, false);
+  SkPoint pts[4];
+  for (SkPath::Verb verb; (verb = iter.next(pts)) != SkPath::kDone_Verb;) {
+    switch (verb) {
+    case SkPath::kMove_Verb:
+      edge(start); // contours are filled as if closed
+      start = last = pts[0];
+      break;
+    case SkPath::kLine_Verb:
+      edge(pts[1]);
+      break;
+    case SkPath::kQuad_Verb:
+    case SkPath::kConic_Verb:
+      edge(pts[1]);
+      edge(pts[2]);
+      break;
+    case SkPath::kCubic_Verb:
+      edge(pts[1]);
+      edge(pts[2]);
+      edge(pts[3]);
+      break;
+    default:
+      break;
     }
+  }
+  edge(start);
+  return area;
+}
+} // namespace
 
-    // Override path style if specified
-    if (styledPath.style.has_value()) {
-      switch (styledPath.style.value()) {
-      case PathStyle::kFill:
-        paint.setStyle(SkPaint::kFill_Style);
-        break;
-      case PathStyle::kStroke:
-        paint.setStyle(SkPaint::kStroke_Style);
-        break;
-      case PathStyle::kStrokeAndFill:
-        paint.setStyle(SkPaint::kStrokeAndFill_Style);
-        break;
-      }
+int Shape::windingSign() const {
+  ensurePaths();
+  if (m_windingSign != kWindingUnknown)
+    return m_windingSign;
+  int sign = 0;
+  for (const auto &styledPath : m_paths) {
+    const double area = signedArea(styledPath.path);
+    const int pathSign = area > 0 ? 1 : area < 0 ? -1 : 0;
+    if (pathSign == 0 || (sign != 0 && pathSign != sign)) {
+      sign = 0;
+      break;
     }
-    canvas->drawPath(styledPath.path, paint);
+    sign = pathSign;
+  }
+  m_windingSign = sign;
+  return sign;
+}
+
+const std::vector<StyledPath> *
+Shape::pathsToDraw(const PaintCacheComponent &paints, float pixelScale) const {
+  ensurePaths();
+  if (pixelScale > 0) {
+    const SkRect bounds = getBoundingBox();
+    const float pixels = std::max(bounds.width(), bounds.height()) * pixelScale;
+    // Indistinguishable from its bounds at this size.
+    if (pixels < kBoundsOnlyPixels)
+      return nullptr;
+    if (pixels < kPathEffectMinPixels || !paints.pathEffect)
+      return pixels < kFlattenBelowPixels ? &lodPaths(lodBucket(pixels))
+                                          : &m_paths;
   }
+  return paints.pathEffect ? &filteredPaths(paints) : &m_paths;
+}
+
+void Shape::render(SkCanvas *canvas, const PaintCacheComponent &paints,
+                   float pixelScale) const {
+  const std::vector<StyledPath> *paths = pathsToDraw(paints, pixelScale);
+  if (!paths) {
+    canvas->drawRect(getBoundingBox(), paints.paintFor(std::nullopt));
+    return;
+  }
+  for (const auto &styledPath : *paths)
+    canvas->drawPath(styledPath.path, paints.paintFor(styledPath.style));
+}
+
+size_t Shape::pathBytes() const {
+  // Counts point storage once per SkPath even where copies share it.
+  auto bytesOf = [](const std::vector<StyledPath> &paths) {
+    size_t bytes = (paths.capacity() - paths.size()) * sizeof(StyledPath);
+    for (const auto &styledPath : paths)
+      bytes += sizeof(StyledPath) - sizeof(SkPath) +
+               styledPath.path.approximateBytesUsed();
+    return bytes;
+  };
+  size_t bytes = bytesOf(m_paths) + bytesOf(m_filteredPaths);
+  for (const auto &paths : m_lodPaths)
+    bytes += bytesOf(paths);
+  return bytes;
+}
+
+const std::vector<StyledPath> &Shape::lodPaths(int bucket) const {
+  bucket = std::min(bucket, kLodBuckets - 1);
+  if (m_lodValid & (1u << bucket))
+    return m_lodPaths[bucket];
+
+  // Flattened for the largest size in the bucket, so the tolerance holds for
+  // every size that maps to it.
+  const SkRect bounds = getBoundingBox();
+  const float extent = std::max(bounds.width(), bounds.height());
+  const float tolerance =
+      kFlattenTolerancePixels * extent / static_cast<float>(2 << bucket);
+
+  auto &out = m_lodPaths[bucket];
+  out.clear();
+  for (const auto &styledPath : m_paths) {
+    StyledPath flat = styledPath;
+    const uint32_t curves = SkPath::kQuad_SegmentMask |
+                            SkPath::kConic_SegmentMask |
+                            SkPath::kCubic_SegmentMask;
+    if (tolerance > 0 && (styledPath.path.getSegmentMasks() & curves))
+      flat.path = flattenPath(styledPath.path, tolerance);
+    out.push_back(std::move(flat));
+  }
+  m_lodValid |= 1u << bucket;
+  return out;
+}
+
+const std::vector<StyledPath> &
+Shape::filteredPaths(const PaintCacheComponent &paints) const {
+  if (m_filteredGeneration == paints.filterGeneration)
+    return m_filteredPaths;
+
+  m_filteredPaths.clear();
+  for (const auto &styledPath : m_paths) {
+    const SkPaint &paint = paints.paintFor(styledPath.style);
+    SkStrokeRec rec(paint);
+    StyledPath filtered;
+    if (paints.pathEffect->filterPath(&filtered.path, styledPath.path, &rec,
+                                      nullptr)) {
+      // Some effects (e.g. dashing a straight line) emit fill geometry.
+      filtered.style = rec.isFillStyle()
+                           ? std::optional<PathStyle>(PathStyle::kFill)
+                           : styledPath.style;
+    } else {
+      filtered = styledPath;
+    }
+    m_filteredPaths.push_back(std::move(filtered));
+  }
+  m_filteredGeneration = paints.filterGeneration;
+  return m_filteredPaths;
+}
+
+void Shape::render(SkCanvas *canvas, const MaterialComponent &material,
+                   const PathEffectComponent *pathEffect) const {
+  PaintCacheComponent paints;
+  paints.rebuild(material, pathEffect);
+  render(canvas, paints);
 }
 
 // For simple shapes, we create one path that can be stroked and/or filled.
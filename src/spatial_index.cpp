@@ -0,0 +1,243 @@
+#include "spatial_index.h"
+#include "memory_report.h"
+
+#include <algorithm>
+#include <cmath>
+
+namespace {
+// Entries covering more cells than this go to the oversized list instead.
+constexpr int kMaxCellsPerEntry = 64;
+
+void eraseValue(std::vector<flecs::entity_t> &v, flecs::entity_t id) {
+  auto it = std::find(v.begin(), v.end(), id);
+  if (it != v.end()) {
+    *it = v.back();
+    v.pop_back();
+  }
+}
+} // namespace
+
+int SpatialIndex::cellOf(float v) const {
+  // Clamped so far-away coordinates cannot overflow the cell math.
+  return static_cast<int>(
+      std::clamp(std::floor(v / cellSize_), -1073741824.f, 1073741824.f));
+}
+
+size_t SpatialIndex::bytesUsed() const {
+  size_t bytes = hashMapBytes(entries_) + hashMapBytes(cells_) +
+                 vectorBytes(oversized_);
+  for (const auto &cell : cells_)
+    bytes += vectorBytes(cell.second);
+  return bytes;
+}
+
+SpatialIndex::SpatialIndex(flecs::world &w, float cellSize)
+    : world_(w), cellSize_(cellSize) {
+  world_.observer<const TransformComponent>()
+      .event(flecs::OnSet)
+      .each([this](flecs::entity e, const TransformComponent &) { update(e); });
+  world_.observer<const ShapeComponent>()
+      .event(flecs::OnSet)
+      .each([this](flecs::entity e, const ShapeComponent &) { update(e); });
+  world_.observer<const InstancedShapeComponent>()
+      .event(flecs::OnSet)
+      .each([this](flecs::entity e, const InstancedShapeComponent &) {
+        update(e);
+      });
+  // Stroke width and path effects change how far the drawing reaches.
+  world_.observer<const MaterialComponent>()
+      .event(flecs::OnSet)
+      .each([this](flecs::entity e, const MaterialComponent &) { update(e); });
+  world_.observer<const PathEffectComponent>()
+      .event(flecs::OnSet)
+      .event(flecs::OnRemove)
+      .each(
+          [this](flecs::entity e, const PathEffectComponent &) { update(e); });
+
+  world_.observer<const TransformComponent>()
+      .event(flecs::OnRemove)
+      .each([this](flecs::entity e, const TransformComponent &) {
+        remove(e.id());
+      });
+  world_.observer<const ShapeComponent>()
+      .event(flecs::OnRemove)
+      .each(
+          [this](flecs::entity e, const ShapeComponent &) { remove(e.id()); });
+  world_.observer<const InstancedShapeComponent>()
+      .event(flecs::OnRemove)
+      .each([this](flecs::entity e, const InstancedShapeComponent &) {
+        remove(e.id());
+      });
+}
+
+bool SpatialIndex::computeBounds(flecs::entity e, SkRect &bounds) const {
+  const auto *tr = e.try_get<TransformComponent>();
+  const auto *sc = e.try_get<ShapeComponent>();
+  const auto *instances = e.try_get<InstancedShapeComponent>();
+  const bool hasShape = sc && sc->shape;
+  if (!tr || (!hasShape && !(instances && instances->shape)))
+    return false;
+
+  const float outset = drawBoundsOutset(e.try_get<MaterialComponent>(),
+                                        e.try_get<PathEffectComponent>());
+  const SkRect local =
+      hasShape ? sc->shape->getBoundingBox().makeOutset(outset, outset)
+               : instances->bounds(outset);
+  bounds = tr->matrix().mapRect(local);
+  return true;
+}
+
+void SpatialIndex::update(flecs::entity e) {
+  SkRect bounds;
+  if (!computeBounds(e, bounds)) {
+    remove(e.id());
+    return;
+  }
+  e.ensure<WorldBoundsComponent>().bounds = bounds;
+  insert(e.id(), bounds);
+}
+
+void SpatialIndex::refresh(flecs::entity e) {
+  SkRect bounds;
+  if (!computeBounds(e, bounds)) {
+    remove(e.id());
+    return;
+  }
+  auto it = entries_.find(e.id());
+  if (it != entries_.end() && it->second.bounds == bounds)
+    return;
+  e.ensure<WorldBoundsComponent>().bounds = bounds;
+  insert(e.id(), bounds);
+}
+
+void SpatialIndex::insert(flecs::entity_t id, const SkRect &bounds) {
+  Entry next;
+  next.bounds = bounds;
+  if (bounds.isFinite() && !bounds.isEmpty()) {
+    next.x0 = cellOf(bounds.left());
+    next.y0 = cellOf(bounds.top());
+    next.x1 = cellOf(bounds.right());
+    next.y1 = cellOf(bounds.bottom());
+    next.oversized = static_cast<int64_t>(next.x1 - next.x0 + 1) *
+                         (next.y1 - next.y0 + 1) >
+                     kMaxCellsPerEntry;
+  } else {
+    // Degenerate and non-finite bounds are only found by full scans.
+    next.oversized = true;
+  }
+
+  auto it = entries_.find(id);
+  if (damageListener_) {
+    if (it != entries_.end())
+      damageListener_(it->second.bounds);
+    damageListener_(bounds);
+  }
+  if (it == entries_.end()) {
+    link(id, next);
+    entries_.emplace(id, next);
+    return;
+  }
+
+  // Most moves stay within the same cells; only the bounds change then.
+  Entry &cur = it->second;
+  if (cur.oversized != next.oversized || cur.x0 != next.x0 ||
+      cur.y0 != next.y0 || cur.x1 != next.x1 || cur.y1 != next.y1) {
+    unlink(id, cur);
+    link(id, next);
+  }
+  next.queryStamp = cur.queryStamp;
+  cur = next;
+}
+
+void SpatialIndex::remove(flecs::entity_t id) {
+  auto it = entries_.find(id);
+  if (it == entries_.end())
+    return;
+  if (damageListener_)
+    damageListener_(it->second.bounds);
+  unlink(id, it->second);
+  entries_.erase(it);
+}
+
+void SpatialIndex::link(flecs::entity_t id, const Entry &entry) {
+  if (entry.oversized) {
+    oversized_.push_back(id);
+    return;
+  }
+  for (int y = entry.y0; y <= entry.y1; ++y)
+    for (int x = entry.x0; x <= entry.x1; ++x)
+      cells_[cellKey(x, y)].push_back(id);
+}
+
+void SpatialIndex::unlink(flecs::entity_t id, const Entry &entry) {
+  if (entry.oversized) {
+    eraseValue(oversized_, id);
+    return;
+  }
+  for (int y = entry.y0; y <= entry.y1; ++y)
+    for (int x = entry.x0; x <= entry.x1; ++x) {
+      auto cell = cells_.find(cellKey(x, y));
+      if (cell == cells_.end())
+        continue;
+      eraseValue(cell->second, id);
+      if (cell->second.empty())
+        cells_.erase(cell);
+    }
+}
+
+void SpatialIndex::query(const SkRect &rect,
+                         std::vector<flecs::entity_t> &out) const {
+  gather(rect, false, out);
+}
+
+void SpatialIndex::query(const SkPoint &pt,
+                         std::vector<flecs::entity_t> &out) const {
+  gather(SkRect::MakeXYWH(pt.x(), pt.y(), 0, 0), true, out);
+}
+
+void SpatialIndex::gather(const SkRect &rect, bool isPoint,
+                          std::vector<flecs::entity_t> &out) const {
+  out.clear();
+  if (!rect.isFinite())
+    return;
+
+  const uint32_t stamp = ++queryStamp_;
+  auto consider = [&](flecs::entity_t id) {
+    const Entry &entry = entries_.at(id);
+    if (entry.queryStamp == stamp)
+      return;
+    entry.queryStamp = stamp;
+    const SkRect &b = entry.bounds;
+    const bool hit =
+        isPoint ? rect.fLeft >= b.fLeft && rect.fLeft <= b.fRight &&
+                      rect.fTop >= b.fTop && rect.fTop <= b.fBottom
+                : SkRect::Intersects(b, rect);
+    if (hit)
+      out.push_back(id);
+  };
+
+  const int x0 = cellOf(rect.left());
+  const int y0 = cellOf(rect.top());
+  const int x1 = cellOf(rect.right());
+  const int y1 = cellOf(rect.bottom());
+
+  // Once the rect covers more cells than there are entries, a straight scan
+  // is cheaper than visiting mostly empty cells.
+  const int64_t cellCount = static_cast<int64_t>(x1 - x0 + 1) * (y1 - y0 + 1);
+  if (cellCount > static_cast<int64_t>(entries_.size())) {
+    for (const auto &kv : entries_)
+      consider(kv.first);
+    return;
+  }
+
+  for (int y = y0; y <= y1; ++y)
+    for (int x = x0; x <= x1; ++x) {
+      auto cell = cells_.find(cellKey(x, y));
+      if (cell == cells_.end())
+        continue;
+      for (flecs::entity_t id : cell->second)
+        consider(id);
+    }
+  for (flecs::entity_t id : oversized_)
+    consider(id);
+}
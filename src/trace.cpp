@@ -0,0 +1,180 @@
+#include "trace.h"
+
+#include <QCoreApplication>
+#include <QFile>
+
+#include <chrono>
+#include <cstdio>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+std::atomic<int> Tracer::level_{static_cast<int>(Tracer::Level::Off)};
+
+namespace {
+struct Span {
+  const char *category;
+  const char *name;
+  int64_t start, end; // ns since the clock's epoch
+  const char *argName;
+  int64_t arg;
+};
+
+// Spans of one thread. Only that thread appends; the lock is uncontended
+// except while stop() collects the spans.
+struct ThreadBuffer {
+  std::mutex mutex;
+  std::vector<Span> spans;
+  int tid = 0;
+  std::string name;
+};
+
+// Buffers outlive their threads: pool and raster threads may be gone by the
+// time the trace is written.
+struct Registry {
+  std::mutex mutex;
+  std::vector<std::shared_ptr<ThreadBuffer>> buffers;
+  int64_t startedAt = 0;
+};
+
+Registry &registry() {
+  static Registry instance;
+  return instance;
+}
+
+ThreadBuffer &threadBuffer() {
+  thread_local std::shared_ptr<ThreadBuffer> buffer = [] {
+    auto b = std::make_shared<ThreadBuffer>();
+    Registry &r = registry();
+    std::lock_guard<std::mutex> lock(r.mutex);
+    b->tid = static_cast<int>(r.buffers.size()) + 1;
+    r.buffers.push_back(b);
+    return b;
+  }();
+  return *buffer;
+}
+
+// Names are literals from this code base, but keep the JSON valid anyway.
+void appendString(QByteArray &out, const char *s) {
+  out += '"';
+  for (; *s; ++s) {
+    if (*s == '"' || *s == '\\')
+      out += '\\';
+    if (static_cast<unsigned char>(*s) >= 0x20)
+      out += *s;
+  }
+  out += '"';
+}
+} // namespace
+
+void Tracer::start(Level level) {
+  Registry &r = registry();
+  {
+    std::lock_guard<std::mutex> lock(r.mutex);
+    for (const auto &buffer : r.buffers) {
+      std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+      buffer->spans.clear();
+    }
+    r.startedAt = now();
+  }
+  level_.store(static_cast<int>(level), std::memory_order_relaxed);
+}
+
+bool Tracer::stop(const QString &path, QString *error) {
+  level_.store(static_cast<int>(Level::Off), std::memory_order_relaxed);
+
+  QFile file(path);
+  if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate)) {
+    if (error)
+      *error = QString("Could not write %1").arg(path);
+    return false;
+  }
+
+  Registry &r = registry();
+  std::lock_guard<std::mutex> lock(r.mutex);
+  const qint64 pid = QCoreApplication::applicationPid();
+  QByteArray out = "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+  bool first = true;
+  char number[160];
+  for (const auto &buffer : r.buffers) {
+    std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+    if (buffer->spans.empty())
+      continue;
+
+    out += first ? "" : ",\n";
+    first = false;
+    std::snprintf(number, sizeof(number),
+                  "{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":%lld,"
+                  "\"tid\":%d,\"args\":{\"name\":",
+                  static_cast<long long>(pid), buffer->tid);
+    out += number;
+    const std::string name = buffer->name.empty()
+                                 ? "thread " + std::to_string(buffer->tid)
+                                 : buffer->name;
+    appendString(out, name.c_str());
+    out += "}}";
+
+    for (const Span &span : buffer->spans) {
+      out += ",\n{\"ph\":\"X\",\"cat\":";
+      appendString(out, span.category);
+      out += ",\"name\":";
+      appendString(out, span.name);
+      // Timestamps are in microseconds.
+      std::snprintf(number, sizeof(number),
+                    ",\"pid\":%lld,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f",
+                    static_cast<long long>(pid), buffer->tid,
+                    (span.start - r.startedAt) / 1e3,
+                    (span.end - span.start) / 1e3);
+      out += number;
+      if (span.argName) {
+        out += ",\"args\":{";
+        appendString(out, span.argName);
+        std::snprintf(number, sizeof(number), ":%lld}",
+                      static_cast<long long>(span.arg));
+        out += number;
+      }
+      out += '}';
+    }
+    buffer->spans = {}; // release the memory, the trace is written
+
+    // Keep the buffer bounded on long recordings.
+    // A failed chunk leaves a truncated file; the next start() clears the
+    // spans that were not written.
+    if (out.size() > (1 << 22)) {
+      if (file.write(out) < 0) {
+        if (error)
+          *error =
+              QString("Could not write %1: %2").arg(path, file.errorString());
+        return false;
+      }
+      out.clear();
+    }
+  }
+  out += "\n]}\n";
+  if (file.write(out) < 0 || !file.flush()) {
+    if (error)
+      *error = QString("Could not write %1: %2").arg(path, file.errorString());
+    return false;
+  }
+  return true;
+}
+
+void Tracer::setThreadName(const char *name) {
+  ThreadBuffer &buffer = threadBuffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  buffer.name = name;
+}
+
+int64_t Tracer::now() {
+  return std::chrono::duration_cast<std::chrono::nanoseconds>(
+             std::chrono::steady_clock::now().time_since_epoch())
+      .count();
+}
+
+void Tracer::addSpan(const char *category, const char *name, int64_t start,
+                     int64_t end, const char *argName, int64_t arg) {
+  ThreadBuffer &buffer = threadBuffer();
+  std::lock_guard<std::mutex> lock(buffer.mutex);
+  buffer.spans.push_back({category, name, start, end, argName, arg});
+}
@@ -1,16 +1,22 @@
 #include "window.h"
 #include "serialization.h"
 
+#include "alloc_tracker.h"
 #include "commands.h"
+#include "exporter.h"
+#include "trace.h"
 
 #include <QAction>
 #include <QComboBox>
+#include <QDialogButtonBox>
+#include <QFontDatabase>
+#include <QHeaderView>
 #include <QInputDialog>
 #include <QMenu>
 #include <QMessageBox>
 #include <QMetaProperty>
 #include <QMetaType>
-#include <QProcess>
+#include <QPlainTextEdit>
 #include <QProgressDialog>
 #include <QScrollArea>
 #include <QtMath>
@@ -121,6 +127,7 @@ MainWindow::MainWindow(QWidget *parent)
   createSceneDock();
   createPropertiesDock();
   createTimelineDock();
+  createProfilerDock();
   setCorner(Qt::BottomRightCorner, Qt::RightDockWidgetArea);
   onNewFile();
 }
@@ -144,7 +151,10 @@ void MainWindow::createMenus() {
   fileMenu->addAction(tr("&Open…"), this, &MainWindow::onOpenFile);
   fileMenu->addAction(tr("&Save"), this, &MainWindow::onSaveFile);
   fileMenu->addSeparator();
+  fileMenu->addAction(tr("Export Frame..."), this, &MainWindow::onExportFrame);
   fileMenu->addAction(tr("Render Video..."), this, &MainWindow::onRenderVideo);
+  fileMenu->addAction(tr("Render Image Sequence..."), this,
+                      &MainWindow::onRenderImageSequence);
   fileMenu->addSeparator();
   fileMenu->addAction(tr("E&xit"), qApp, &QCoreApplication::quit);
 
@@ -191,6 +201,71 @@ void MainWindow::createMenus() {
   connect(resetViewAction, &QAction::triggered, m_canvas,
           &SkiaCanvasWidget::resetView);
 
+  viewMenu->addSeparator();
+  m_profilerAction = viewMenu->addAction(tr("Frame Profiler"));
+  m_profilerAction->setCheckable(true);
+  connect(m_profilerAction, &QAction::toggled, this,
+          [this](bool on) { m_profilerDock->setVisible(on); });
+
+  QAction *overlayAction = viewMenu->addAction(tr("Profiler Overlay"));
+  overlayAction->setCheckable(true);
+  connect(overlayAction, &QAction::toggled, this, [this](bool on) {
+    m_canvas->setProfilerOverlayVisible(on);
+    updateProfiling();
+  });
+
+  // Spans are kept in memory and written as a Chrome trace when recording
+  // stops, for chrome://tracing or ui.perfetto.dev.
+  auto *traceEntitiesAction = new QAction(tr("Trace Every Script Call"), this);
+  traceEntitiesAction->setCheckable(true);
+  QAction *traceAction = viewMenu->addAction(tr("Record Trace"));
+  traceAction->setCheckable(true);
+  connect(traceAction, &QAction::toggled, this,
+          [this, traceEntitiesAction](bool on) {
+            if (on) {
+              Tracer::start(traceEntitiesAction->isChecked()
+                                ? Tracer::Level::Entities
+                                : Tracer::Level::Frames);
+              return;
+            }
+            const QString path = QFileDialog::getSaveFileName(
+                this, tr("Save Trace"), "trace.json",
+                tr("Chrome Trace (*.json)"));
+            QString error;
+            if (path.isEmpty())
+              Tracer::start(Tracer::Level::Off); // discard
+            else if (!Tracer::stop(path, &error))
+              QMessageBox::critical(this, tr("Error"), error);
+          });
+  viewMenu->addAction(traceEntitiesAction);
+
+  // Counts every allocation on the GUI thread into the profiler's phases.
+  QAction *allocAction = viewMenu->addAction(tr("Track Allocations"));
+  allocAction->setCheckable(true);
+  connect(allocAction, &QAction::toggled, this,
+          [](bool on) { AllocTracker::setEnabled(on); });
+
+  QAction *budgetAction = viewMenu->addAction(tr("Slow Frame Budget..."));
+  connect(budgetAction, &QAction::triggered, this, [this]() {
+    FlightRecorder &recorder = m_canvas->flightRecorder();
+    FlightRecorder::Settings settings = recorder.settings();
+    bool ok = false;
+    const double ms = QInputDialog::getDouble(
+        this, tr("Slow Frame Budget"),
+        tr("Save the last %1 s of frame timings when a frame takes longer "
+           "than (ms):")
+            .arg(settings.windowSeconds),
+        settings.budgetMs, 1.0, 10000.0, 1, &ok);
+    if (!ok)
+      return;
+    settings.budgetMs = ms;
+    recorder.setSettings(settings);
+  });
+
+  QAction *memoryAction = viewMenu->addAction(tr("Memory Report..."));
+  connect(memoryAction, &QAction::triggered, this,
+          &MainWindow::showMemoryReport);
+
   // --- Playback -------------------------------------------------------
   QMenu *playMenu = menuBar()->addMenu(tr("&Playback"));
   playMenu->addAction(tr("Play"));
@@ -294,6 +369,19 @@ void MainWindow::createTimelineDock() {
   m_timeDisplayLabel = new QLabel("0.00s / 0.00s");
   timelineLayout->addWidget(m_timeDisplayLabel);
 
+  // Preview quality the canvas fell back to while it cannot keep up.
+  m_proxyLabel = new QLabel(tr("Preview: full"));
+  connect(m_canvas, &SkiaCanvasWidget::proxyLevelChanged, this,
+          [this](int level, float scale, bool draft) {
+            if (level == 0)
+              m_proxyLabel->setText(tr("Preview: full"));
+            else
+              m_proxyLabel->setText(tr("Preview: %1%%2")
+                                        .arg(qRound(scale * 100))
+                                        .arg(draft ? tr(" draft") : ""));
+          });
+  timelineLayout->addWidget(m_proxyLabel);
+
   m_timelineSlider = new QSlider(Qt::Horizontal);
   m_timelineSlider->setRange(
       0, static_cast<int>(m_animationDuration * 100)); // 100 units per
@@ -316,7 +404,177 @@ void MainWindow::createTimelineDock() {
   m_animationTimer = new QTimer(this);
   connect(m_animationTimer, &QTimer::timeout, this,
           &MainWindow::onAnimationTimerTimeout);
-  m_animationTimer->setInterval(16); // ~60 FPS
+  // Polls about twice per simulation step; m_playbackClock decides when a
+  // new frame is due from the wall clock.
+  m_animationTimer->setTimerType(Qt::PreciseTimer);
+  m_animationTimer->setInterval(8);
+}
+
+void MainWindow::createProfilerDock() {
+  m_profilerDock = new QDockWidget(tr("Profiler"), this);
+  m_profilerDock->setAllowedAreas(Qt::AllDockWidgetAreas);
+
+  auto *panel = new QWidget(m_profilerDock);
+  auto *layout = new QVBoxLayout(panel);
+
+  m_profilerSummary = new QLabel(tr("No frames yet"), panel);
+  layout->addWidget(m_profilerSummary);
+
+  auto makeTable = [panel](const QStringList &headers) {
+    auto *table = new QTableWidget(0, headers.size(), panel);
+    table->setHorizontalHeaderLabels(headers);
+    table->verticalHeader()->setVisible(false);
+    table->horizontalHeader()->setSectionResizeMode(QHeaderView::Stretch);
+    table->setEditTriggers(QAbstractItemView::NoEditTriggers);
+    table->setSelectionMode(QAbstractItemView::NoSelection);
+    return table;
+  };
+  m_phaseTable = makeTable({tr("Phase"), tr("Last ms"), tr("Avg ms"),
+                            tr("Max ms"), tr("Allocs"), tr("Alloc KiB")});
+  m_phaseTable->setRowCount(kFramePhaseCount);
+  layout->addWidget(m_phaseTable);
+  m_systemTable = makeTable({tr("System"), tr("ms"), tr("Entities")});
+  layout->addWidget(m_systemTable);
+
+  m_profilerDock->setWidget(panel);
+  addDockWidget(Qt::BottomDockWidgetArea, m_profilerDock);
+  m_profilerDock->hide();
+  updateProfiling();
+
+  m_profilerRefreshTimer = new QTimer(this);
+  m_profilerRefreshTimer->setInterval(250);
+  connect(m_profilerRefreshTimer, &QTimer::timeout, this,
+          &MainWindow::refreshProfilerDock);
+
+  connect(m_profilerDock, &QDockWidget::visibilityChanged, this,
+          [this](bool visible) {
+            QSignalBlocker blocker(m_profilerAction);
+            m_profilerAction->setChecked(visible);
+            updateProfiling();
+          });
+}
+
+void MainWindow::updateProfiling() {
+  // Phase timings are always recorded for the flight recorder; per-system
+  // timing only while someone looks at it.
+  const bool panel = m_profilerDock && m_profilerDock->isVisible();
+  FrameProfiler &profiler = m_canvas->scene().profiler();
+  profiler.setEnabled(true);
+  profiler.setSystemTimingEnabled(panel ||
+                                  m_canvas->profilerOverlayVisible());
+  if (panel)
+    m_profilerRefreshTimer->start();
+  else
+    m_profilerRefreshTimer->stop();
+}
+
+void MainWindow::refreshProfilerDock() {
+  // About two seconds of history at 60 fps.
+  const std::vector<FrameSample> frames =
+      m_canvas->scene().profiler().samples().recent(120);
+  if (frames.empty())
+    return;
+
+  auto setCell = [](QTableWidget *table, int row, int column,
+                    const QString &text) {
+    if (QTableWidgetItem *item = table->item(row, column))
+      item->setText(text);
+    else
+      table->setItem(row, column, new QTableWidgetItem(text));
+  };
+
+  double totalSum = 0, totalMax = 0;
+  for (const FrameSample &f : frames) {
+    totalSum += f.totalMs;
+    totalMax = std::max<double>(totalMax, f.totalMs);
+  }
+  const FrameSample &last = frames.back();
+  m_profilerSummary->setText(
+      tr("Frame %1 ms (avg %2, max %3)   drawn %4, replayed %5, culled %6"
+         "   script calls: %7 Lua, %8 C++")
+          .arg(last.totalMs, 0, 'f', 2)
+          .arg(totalSum / frames.size(), 0, 'f', 2)
+          .arg(totalMax, 0, 'f', 2)
+          .arg(last.entitiesDrawn)
+          .arg(last.entitiesReplayed)
+          .arg(last.entitiesCulled)
+          .arg(last.luaCalls)
+          .arg(last.cppCalls) +
+      (AllocTracker::enabled()
+           ? tr("   allocations: %1 (%2 KiB), %3 in Lua")
+                 .arg(last.allocs)
+                 .arg(last.allocBytes / 1024.0, 0, 'f', 1)
+                 .arg(last.luaAllocs)
+           : QString()));
+
+  for (int i = 0; i < kFramePhaseCount; ++i) {
+    double sum = 0, max = 0;
+    for (const FrameSample &f : frames) {
+      sum += f.phaseMs[i];
+      max = std::max<double>(max, f.phaseMs[i]);
+    }
+    setCell(m_phaseTable, i, 0,
+            framePhaseName(static_cast<FramePhase>(i)));
+    setCell(m_phaseTable, i, 1, QString::number(last.phaseMs[i], 'f', 3));
+    setCell(m_phaseTable, i, 2, QString::number(sum / frames.size(), 'f', 3));
+    setCell(m_phaseTable, i, 3, QString::number(max, 'f', 3));
+    setCell(m_phaseTable, i, 4, QString::number(last.phaseAllocs[i]));
+    setCell(m_phaseTable, i, 5,
+            QString::number(last.phaseAllocBytes[i] / 1024.0, 'f', 1));
+  }
+
+  m_systemTable->setRowCount(last.systemCount);
+  for (int i = 0; i < last.systemCount; ++i) {
+    const SystemSample &system = last.systems[i];
+    setCell(m_systemTable, i, 0, QString::fromUtf8(system.name));
+    setCell(m_systemTable, i, 1, QString::number(system.ms, 'f', 3));
+    setCell(m_systemTable, i, 2, QString::number(system.entities));
+  }
+}
+
+// Macros (paste, multi-entity edits) keep their work in child commands.
+static size_t undoCommandBytes(const QUndoCommand *command) {
+  const auto *scene = dynamic_cast<const SceneCommand *>(command);
+  size_t bytes = scene ? scene->approximateBytes() : sizeof(QUndoCommand);
+  for (int i = 0; i < command->childCount(); ++i)
+    bytes += undoCommandBytes(command->child(i));
+  return bytes;
+}
+
+void MainWindow::showMemoryReport() {
+  MemoryReport report = measureSceneMemory(m_canvas->scene());
+  MemoryReport::Section &editor = report.section("editor");
+  size_t undoBytes = 0;
+  for (int i = 0; i < m_undoStack->count(); ++i)
+    undoBytes += undoCommandBytes(m_undoStack->command(i));
+  editor.add("undo stack", m_undoStack->count(), undoBytes);
+  m_canvas->measureMemory(editor);
+
+  QDialog dialog(this);
+  dialog.setWindowTitle(tr("Memory Report"));
+  auto *layout = new QVBoxLayout(&dialog);
+  auto *text = new QPlainTextEdit(report.toText(), &dialog);
+  text->setReadOnly(true);
+  text->setFont(QFontDatabase::systemFont(QFontDatabase::FixedFont));
+  text->setLineWrapMode(QPlainTextEdit::NoWrap);
+  layout->addWidget(text);
+  auto *buttons =
+      new QDialogButtonBox(QDialogButtonBox::Save | QDialogButtonBox::Close);
+  layout->addWidget(buttons);
+  connect(buttons, &QDialogButtonBox::rejected, &dialog, &QDialog::reject);
+  connect(buttons, &QDialogButtonBox::accepted, &dialog, [&]() {
+    const QString path = QFileDialog::getSaveFileName(
+        &dialog, tr("Save Memory Report"), "memory.json", tr("JSON (*.json)"));
+    if (path.isEmpty())
+      return;
+    QFile file(path);
+    if (!file.open(QIODevice::WriteOnly | QIODevice::Truncate) ||
+        file.write(QJsonDocument(report.toJson()).toJson()) < 0)
+      QMessageBox::critical(&dialog, tr("Error"),
+                            tr("Could not write %1").arg(path));
+  });
+  dialog.resize(640, 480);
+  dialog.exec();
 }
 
 void MainWindow::onSceneSelectionChanged(const QItemSelection &sel,
@@ -881,6 +1139,7 @@ void MainWindow::onSceneSelectionChanged(const QItemSelection &sel,
                       }
                       if (ok) {
                         pec2.dashIntervals = newIntervals;
+                        e.modified<PathEffectComponent>();
                         m_canvas->update();
                       }
                     }
@@ -891,6 +1150,7 @@ void MainWindow::onSceneSelectionChanged(const QItemSelection &sel,
               [this, e](double v) {
                 if (e.has<PathEffectComponent>()) {
                   e.get_mut<PathEffectComponent>().dashPhase = v;
+                  e.modified<PathEffectComponent>();
                   m_canvas->update();
                 }
               });
@@ -904,6 +1164,7 @@ void MainWindow::onSceneSelectionChanged(const QItemSelection &sel,
               [this, e](double v) {
                 if (e.has<PathEffectComponent>()) {
                   e.get_mut<PathEffectComponent>().cornerRadius = v;
+                  e.modified<PathEffectComponent>();
                   m_canvas->update();
                 }
               });
@@ -917,6 +1178,7 @@ void MainWindow::onSceneSelectionChanged(const QItemSelection &sel,
               [this, e](double v) {
                 if (e.has<PathEffectComponent>()) {
                   e.get_mut<PathEffectComponent>().discreteLength = v;
+                  e.modified<PathEffectComponent>();
                   m_canvas->update();
                 }
               });
@@ -927,6 +1189,7 @@ void MainWindow::onSceneSelectionChanged(const QItemSelection &sel,
               [this, e](double v) {
                 if (e.has<PathEffectComponent>()) {
                   e.get_mut<PathEffectComponent>().discreteDeviation = v;
+                  e.modified<PathEffectComponent>();
                   m_canvas->update();
                 }
               });
@@ -954,6 +1217,7 @@ void MainWindow::onSceneSelectionChanged(const QItemSelection &sel,
                     e.get_mut<PathEffectComponent>().type =
                         typeCombo->itemData(index)
                             .value<PathEffectComponent::Type>();
+                    e.modified<PathEffectComponent>();
                     updateVisibility(index);
                     m_canvas->update();
                   }
@@ -1151,7 +1415,8 @@ void MainWindow::resetScene() {
                             QItemSelection());
 }
 
-void MainWindow::onRenderVideo() {
+bool MainWindow::promptRenderResolution(const QString &title, int &width,
+                                        int &height) {
   // Get resolution from user
   bool ok;
   QStringList items;
@@ -1161,28 +1426,57 @@ void MainWindow::onRenderVideo() {
         << "HD (1280x720)"
         << "Full HD (1920x1080)"
         << "4K (3840x2160)";
-  QString item = QInputDialog::getItem(this, tr("Select Render Resolution"),
-                                       tr("Resolution:"), items, 0, false, &ok);
+  QString item = QInputDialog::getItem(this, title, tr("Resolution:"), items, 0,
+                                       false, &ok);
   if (!ok || item.isEmpty()) {
-    return; // User cancelled
+    return false; // User cancelled
   }
 
-  int targetWidth, targetHeight;
   if (item.startsWith("Current")) {
-    targetWidth = m_canvas->width();
-    targetHeight = m_canvas->height();
+    width = m_canvas->width();
+    height = m_canvas->height();
   } else if (item.startsWith("HD")) {
-    targetWidth = 1280;
-    targetHeight = 720;
+    width = 1280;
+    height = 720;
   } else if (item.startsWith("Full HD")) {
-    targetWidth = 1920;
-    targetHeight = 1080;
+    width = 1920;
+    height = 1080;
   } else if (item.startsWith("4K")) {
-    targetWidth = 3840;
-    targetHeight = 2160;
+    width = 3840;
+    height = 2160;
   } else {
-    return; // Should not happen
+    return false; // Should not happen
   }
+  return true;
+}
+
+void MainWindow::onExportFrame() {
+  int targetWidth, targetHeight;
+  if (!promptRenderResolution(tr("Select Frame Resolution"), targetWidth,
+                              targetHeight))
+    return;
+
+  QString imagePath = QFileDialog::getSaveFileName(this, tr("Export Frame"), "",
+                                                   tr("PNG Image (*.png)"));
+  if (imagePath.isEmpty())
+    return;
+  if (!imagePath.endsWith(".png", Qt::CaseInsensitive))
+    imagePath += ".png";
+
+  // Tiles are rasterized on every core, so large frames come back quickly.
+  QImage frame =
+      m_canvas->renderHighResFrame(targetWidth, targetHeight, m_currentTime, 0);
+  if (frame.isNull() || !frame.save(imagePath)) {
+    QMessageBox::critical(this, "Error",
+                          tr("Could not export frame to %1").arg(imagePath));
+  }
+}
+
+void MainWindow::onRenderVideo() {
+  int targetWidth, targetHeight;
+  if (!promptRenderResolution(tr("Select Render Resolution"), targetWidth,
+                              targetHeight))
+    return;
 
   QString videoPath = QFileDialog::getSaveFileName(this, tr("Render Video"), "",
                                                    tr("MP4 Video (*.mp4)"));
@@ -1195,6 +1489,40 @@ void MainWindow::onRenderVideo() {
     videoPath += ".mp4";
   }
 
+  FfmpegSink sink(videoPath); // Assume ffmpeg is in PATH
+  renderAnimation(sink, targetWidth, targetHeight, tr("Video"));
+}
+
+void MainWindow::onRenderImageSequence() {
+  int targetWidth, targetHeight;
+  if (!promptRenderResolution(tr("Select Render Resolution"), targetWidth,
+                              targetHeight))
+    return;
+
+  bool ok;
+  const QStringList formats = {"PNG", "WebP (lossless)", "Raw RGBA"};
+  const QString choice = QInputDialog::getItem(
+      this, tr("Render Image Sequence"), tr("Format:"), formats, 0, false, &ok);
+  if (!ok || choice.isEmpty())
+    return;
+  ImageSequenceSink::Format format = ImageSequenceSink::Format::Png;
+  if (choice.startsWith("WebP"))
+    format = ImageSequenceSink::Format::WebP;
+  else if (choice.startsWith("Raw"))
+    format = ImageSequenceSink::Format::Raw;
+
+  const QString directory = QFileDialog::getExistingDirectory(
+      this, tr("Render Image Sequence Into"));
+  if (directory.isEmpty())
+    return;
+
+  // Frames are encoded on every core while later ones are still rendering.
+  ImageSequenceSink sink(directory, format);
+  renderAnimation(sink, targetWidth, targetHeight, tr("Image sequence"));
+}
+
+void MainWindow::renderAnimation(FrameSink &sink, int targetWidth,
+                                 int targetHeight, const QString &what) {
   // Settings
   const int fps = 60;
   const float duration = m_animationDuration;
@@ -1212,7 +1540,9 @@ void MainWindow::onRenderVideo() {
 
   // Prepare for rendering
   m_animationTimer->stop();
+  m_playbackClock.pause();
   m_isPlaying = false;
+  m_canvas->setPlaying(false);
   m_playPauseButton->setText("Play");
   m_currentTime = 0.f;
   m_canvas->scene().getScriptSystem().resetEnvironments();
@@ -1220,76 +1550,38 @@ void MainWindow::onRenderVideo() {
   m_timelineSlider->setValue(0);
   updateTimeDisplay();
 
-  QProgressDialog progress("Rendering video...", "Cancel", 0, totalFrames,
-                           this);
+  QProgressDialog progress(tr("Rendering %1...").arg(what.toLower()),
+                           tr("Cancel"), 0, totalFrames, this);
   progress.setWindowModality(Qt::WindowModal);
 
-  // Setup ffmpeg
-  QString ffmpegPath = "ffmpeg"; // Assume ffmpeg is in PATH
-  QStringList args;
-  args << "-y"
-       << "-f"
-       << "rawvideo"
-       << "-pix_fmt"
-       << "rgba"
-       << "-s" << QString("%1x%2").arg(targetWidth).arg(targetHeight) << "-r"
-       << QString::number(fps) << "-i"
-       << "-" // Input from stdin
-       << "-vf"
-       << "crop=trunc(iw/2)*2:trunc(ih/2)*2"
-       << "-c:v"
-       << "libx264"
-       << "-pix_fmt"
-       << "yuv420p" << videoPath;
-
-  QProcess ffmpegProcess;
-  ffmpegProcess.start(ffmpegPath, args);
-  if (!ffmpegProcess.waitForStarted()) {
-    QMessageBox::critical(
-        this, "Error",
-        "Could not start ffmpeg. Is it installed and in your PATH?");
-    m_canvas->resetSceneAndDeserialize(sceneState); // Restore
-    return;
-  }
-
   m_canvas->setVideoRendering(true);
 
-  for (int i = 0; i < totalFrames; ++i) {
-    progress.setValue(i);
-    if (progress.wasCanceled()) {
-      break;
-    }
+  // Frames are recorded here and rasterized on all cores into a ring of
+  // buffers; a writer thread hands them to the sink in order.
+  FrameExporter::Settings settings;
+  settings.width = targetWidth;
+  settings.height = targetHeight;
+  settings.fps = fps;
+  settings.frameCount = totalFrames;
+  settings.transform = m_canvas->exportMatrix(targetWidth, targetHeight);
+
+  FrameExporter exporter(m_canvas->scene(), settings);
+  FrameExporter::Result result = exporter.run(sink, [&](int frame) {
+    progress.setValue(frame);
     qApp->processEvents();
-
-    float currentTime = static_cast<float>(i) / fps;
-
-    // Update scene for the frame
-    m_canvas->scene().getScriptSystem().tick(1.0f / fps, currentTime);
-
-    // Render the high-resolution frame offscreen
-    QImage frame =
-        m_canvas->renderHighResFrame(targetWidth, targetHeight, currentTime);
-
-    if (frame.isNull()) {
-      qWarning() << "Failed to render high-res frame" << i;
-      continue;
-    }
-
-    ffmpegProcess.write(reinterpret_cast<const char *>(frame.constBits()),
-                        frame.sizeInBytes());
-  }
+    return !progress.wasCanceled();
+  });
+  qDebug() << what << "export:" << result.summary();
 
   m_canvas->setVideoRendering(false);
   progress.setValue(totalFrames);
 
-  ffmpegProcess.closeWriteChannel();
-  if (!ffmpegProcess.waitForFinished(30000)) { // 30s timeout
-    ffmpegProcess.kill();
-    QMessageBox::critical(this, "Error",
-                          "ffmpeg timed out or failed to finish.");
-    qWarning() << "ffmpeg stderr:" << ffmpegProcess.readAllStandardError();
-  } else {
-    QMessageBox::information(this, "Success", "Video rendering complete.");
+  if (!result.error.isEmpty()) {
+    QMessageBox::critical(this, "Error", result.error);
+  } else if (!result.cancelled) {
+    QMessageBox::information(
+        this, "Success",
+        QString("%1 rendering complete.\n%2").arg(what, result.summary()));
   }
 
   // Restore original scene state
@@ -1419,15 +1711,27 @@ void MainWindow::clearLayout(QLayout *layout) {
 }
 
 void MainWindow::updateTimeDisplay() {
-  m_timeDisplayLabel->setText(QString("%1s / %2s")
-                                  .arg(m_currentTime, 0, 'f', 2)
-                                  .arg(m_animationDuration, 0, 'f', 2));
+  QString text = QString("%1s / %2s")
+                     .arg(m_currentTime, 0, 'f', 2)
+                     .arg(m_animationDuration, 0, 'f', 2);
+  // Timeline vs. real time since Play; they drift apart when the catch-up
+  // cap gives up steps.
+  const PlaybackClock::Stats &stats = m_playbackClock.stats();
+  if (stats.framesShown > 0)
+    text += tr("  (%1s in %2s real, %3 dropped)")
+                .arg(stats.timelineSeconds, 0, 'f', 2)
+                .arg(stats.wallSeconds, 0, 'f', 2)
+                .arg(stats.framesDropped);
+  m_timeDisplayLabel->setText(text);
   m_canvas->update();
 }
 
 void MainWindow::onStopResetButtonClicked() {
   m_animationTimer->stop();
+  m_playbackClock.pause();
+  m_playbackClock.resetStats();
   m_isPlaying = false;
+  m_canvas->setPlaying(false);
   m_playPauseButton->setText("Play");
   m_currentTime = 0.f;
   m_canvas->scene().getScriptSystem().resetEnvironments();
@@ -1445,36 +1749,55 @@ void MainWindow::onStopResetButtonClicked() {
 }
 
 void MainWindow::onAnimationTimerTimeout() {
-  m_currentTime += m_animationTimer->interval() / 1000.f;
-  if (m_currentTime > m_animationDuration) {
-    m_canvas->scene().getScriptSystem().resetEnvironments();
-    m_currentTime = 0.f;
-    if (!m_preSimulationState.isEmpty()) {
-      m_animationTimer->stop();
-      m_isPlaying = false;
-      m_playPauseButton->setText("Play");
-      m_canvas->setCurrentTime(m_currentTime);
-      m_canvas->setSelectedEntities({});
-      onSceneSelectionChanged({}, {});
-      m_canvas->resetSceneAndDeserialize(m_preSimulationState);
-      m_sceneModel->refresh();
-      m_canvas->update();
-      m_timelineSlider->setValue(0);
-      updateTimeDisplay();
-      return;
+  // Simulate every fixed step that is due, then show only the last one.
+  const int steps = m_playbackClock.advance();
+  if (steps == 0)
+    return;
+  const float dt = static_cast<float>(m_playbackClock.step());
+  QElapsedTimer updateTimer;
+  updateTimer.start();
+
+  for (int i = 0; i < steps; ++i) {
+    m_currentTime += dt;
+    if (m_currentTime > m_animationDuration) {
+      m_canvas->scene().getScriptSystem().resetEnvironments();
+      m_currentTime = 0.f;
+      if (!m_preSimulationState.isEmpty()) {
+        m_animationTimer->stop();
+        m_playbackClock.pause();
+        m_isPlaying = false;
+        m_canvas->setPlaying(false);
+        m_playPauseButton->setText("Play");
+        m_canvas->setCurrentTime(m_currentTime);
+        m_canvas->setSelectedEntities({});
+        onSceneSelectionChanged({}, {});
+        m_canvas->resetSceneAndDeserialize(m_preSimulationState);
+        m_sceneModel->refresh();
+        m_canvas->update();
+        m_timelineSlider->setValue(0);
+        updateTimeDisplay();
+        return;
+      }
     }
+
+    {
+      FrameProfiler::Scope scope(m_canvas->scene().profiler(),
+                                 FramePhase::LuaTick);
+      m_canvas->scene().getScriptSystem().tick(dt, m_currentTime);
+    }
+    m_canvas->scene().update(dt, m_currentTime);
   }
+  m_canvas->flightRecorder().noteUpdate(updateTimer.nsecsElapsed() / 1e6);
 
   m_canvas->setCurrentTime(m_currentTime);
-  m_canvas->scene().getScriptSystem().tick(
-      m_animationTimer->interval() / 1000.f, m_currentTime);
-
-  m_canvas->scene().update(m_animationTimer->interval() / 1000.f,
-                           m_currentTime);
-
   m_canvas->update();
 
-  m_timelineSlider->setValue(static_cast<int>(m_currentTime * 100));
+  // Moving the slider would round m_currentTime to its 10 ms resolution
+  // through onTimelineSliderMoved and slow playback down.
+  {
+    QSignalBlocker blocker(m_timelineSlider);
+    m_timelineSlider->setValue(static_cast<int>(m_currentTime * 100));
+  }
   updateTimeDisplay();
 }
 
@@ -1487,6 +1810,7 @@ void MainWindow::onTimelineSliderMoved(int value) {
 
 void MainWindow::onDurationChanged(double value) {
   m_animationDuration = value;
+  m_canvas->setTimelineDuration(m_animationDuration);
   m_timelineSlider->setRange(0, static_cast<int>(m_animationDuration * 100));
   updateTimeDisplay();
 }
@@ -1495,16 +1819,24 @@ void MainWindow::onPlayPauseButtonClicked() {
   if (m_isPlaying) {
     // Pause
     m_animationTimer->stop();
+    m_playbackClock.pause();
+    const PlaybackClock::Stats &stats = m_playbackClock.stats();
+    qDebug() << "Playback:" << stats.framesShown << "frames shown,"
+             << stats.framesDropped << "dropped," << stats.stepsSkipped
+             << "steps skipped," << stats.timelineSeconds << "s timeline in"
+             << stats.wallSeconds << "s real";
     m_playPauseButton->setText("Play");
   } else {
     // Play
     // if (m_currentTime == 0.f) {
     //   m_preSimulationState = m_canvas->scene().serialize();
     // }
+    m_playbackClock.start();
     m_animationTimer->start();
     m_playPauseButton->setText("Pause");
   }
   m_isPlaying = !m_isPlaying;
+  m_canvas->setPlaying(m_isPlaying);
 }
 
 void MainWindow::syncTransformEditors(Entity e) {